@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include <vtkActor.h>
+#include <vtkCamera.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPNGWriter.h>
+#include <vtkPointData.h>
+#include <vtkPointGaussianMapper.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkProperty.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderer.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkWindowToImageFilter.h>
+
+#include "utility.hpp"
+#include "workerPool.hpp"
+#include "datasetDescriptor.hpp"
+#include "vis/loaders.hpp"
+#include "vis/visUtility.hpp"
+#include "vis/edgeInstances.hpp"
+
+// Renders a range of timesteps without a display into PNG files or a raw stream of RGB frames with top-down rows,
+// e.g. for ffmpeg -f rawvideo -pixel_format rgb24 -video_size WxH.
+// Usage: BatchRender --first T --last T [--step S] [--attribute A] [--filter low high] [--derivatives] [--edges]
+//                    [--scattered] [--point-size S] [--size W H] [--camera px py pz fx fy fz ux uy uz]
+//                    [--output folder | --raw file] [--data folder]
+// Reading and color mapping of the upcoming frames and PNG encoding run on the worker pool while the current frame
+// renders. Rendering itself stays on the main thread, there is a single OpenGL context. Without a display VTK has to
+// be built with OSMesa or EGL, the offscreen render window then doesn't need a windowing system.
+
+namespace {
+
+    struct Options {
+        int first = 0;
+        // Last timestep of the dataset if not set
+        int last = -1;
+        int step = 1;
+        int attribute = 4;
+        Range filter = Range::Whole();
+        bool derivatives = false;
+        bool edges = false;
+        bool scattered = false;
+        double pointSize = 0.9;
+        int width = 1920;
+        int height = 1080;
+        std::optional<std::array<double, 9>> camera;
+        std::filesystem::path output = "renders";
+        std::filesystem::path raw;
+    };
+
+    Options parseOptions(int argc, char** argv) {
+        Options options;
+        int i = 1;
+        auto next = [&](std::string_view name) -> const char* {
+            if (i + 1 >= argc) {
+                std::cout << "Missing value of " << name << std::endl;
+                throw std::runtime_error("Invalid argument");
+            }
+            return argv[++i];
+        };
+
+        for (; i < argc; i++) {
+            std::string_view name = argv[i];
+            if (name == "--first") options.first = std::stoi(next(name));
+            else if (name == "--last") options.last = std::stoi(next(name));
+            else if (name == "--step") options.step = std::max(1, std::stoi(next(name)));
+            else if (name == "--attribute") options.attribute = std::stoi(next(name));
+            else if (name == "--filter") {
+                double low = std::stod(next(name));
+                double high = std::stod(next(name));
+                options.filter = Range{ low, high };
+            }
+            else if (name == "--derivatives") options.derivatives = true;
+            else if (name == "--edges") options.edges = true;
+            else if (name == "--scattered") options.scattered = true;
+            else if (name == "--point-size") options.pointSize = std::stod(next(name));
+            else if (name == "--size") {
+                options.width = std::stoi(next(name));
+                options.height = std::stoi(next(name));
+            }
+            else if (name == "--camera") {
+                std::array<double, 9> camera;
+                for (auto& value : camera) {
+                    value = std::stod(next(name));
+                }
+                options.camera = camera;
+            }
+            else if (name == "--output") options.output = next(name);
+            else if (name == "--raw") options.raw = next(name);
+            // The dataset is only read after all options were parsed
+            else if (name == "--data") dataFolder = next(name);
+            else {
+                std::cout << "Unknown option " << name << std::endl;
+                throw std::runtime_error("Invalid argument");
+            }
+        }
+
+        const int lastTimestep = static_cast<int>(dataset().timestepCount) - 1;
+        if (options.last < 0) {
+            options.last = lastTimestep;
+        }
+        if (options.attribute < 0 || options.attribute >= NeuronProperties::attributeCount || options.first < 0
+            || options.last > lastTimestep || options.first > options.last) {
+            std::cout << std::format("Attribute has to be in [0, {}] and the timesteps in [0, {}]",
+                NeuronProperties::attributeCount - 1, lastTimestep) << std::endl;
+            throw std::runtime_error("Invalid argument");
+        }
+        return options;
+    }
+
+    struct Frame {
+        int timestep;
+        // Only the points inside the filter, like Visualisation::applyColors
+        vtkSmartPointer<vtkPoints> positions;
+        vtkSmartPointer<vtkUnsignedCharArray> colors;
+    };
+
+    // Same color range as Visualisation::reloadColors
+    Frame loadFrame(const Options& options, const Statistics& globalStatistics, std::span<const Position> positions, int timestep) {
+        double min = globalStatistics.min;
+        double max = globalStatistics.max;
+        if (options.derivatives) {
+            std::tie(min, max) = diffMinMax(timestep, options.attribute);
+        }
+        auto colors = loadColors(timestep, options.attribute, min, max, options.filter, options.derivatives);
+
+        // Scattered points are paired with the colors by index like in Visualisation::applyColors
+        auto pointColors = colorSpan(*colors);
+        pointColors = pointColors.first(std::min(pointColors.size(), positions.size()));
+        std::vector<uint32_t> visible;
+        visibleIndices(pointColors, visible);
+        Frame frame{ timestep, vtkSmartPointer<vtkPoints>::New(), vtkSmartPointer<vtkUnsignedCharArray>::New() };
+        compactPoints(positions, pointColors, visible, *frame.positions, *frame.colors);
+        return frame;
+    }
+
+    // Edges of the network snapshot of `timestep` as arrows between the position clusters, like Visualisation::reloadEdges
+    class EdgePipeline {
+        int snapshot = -1;
+
+    public:
+        EdgeInstances instances;
+
+        void update(vtkPoints& aggregatedPoints, int timestep) {
+            if (snapshot == dataset().snapshotOf(timestep)) {
+                return;
+            }
+            snapshot = dataset().snapshotOf(timestep);
+            instances.update(aggregatedPoints, loadEdges(timestep));
+        }
+    };
+}
+
+int main(int argc, char** argv) {
+    using namespace std::chrono;
+    setCurrentDirectory();
+    auto options = parseOptions(argc, argv);
+
+    vtkNew<vtkPoints> originalPositions, scatteredPositions, aggregatedPoints;
+    std::vector<uint32_t> mapping;
+    loadPositions(*originalPositions, *scatteredPositions, *aggregatedPoints, mapping);
+
+    HistogramDataLoader histogramDataLoader;
+    auto globalStatistics = histogramDataLoader.getAttributeData(options.attribute).globalStatistics;
+
+    auto positions = positionSpan(options.scattered ? *scatteredPositions : *originalPositions);
+    vtkNew<vtkPolyData> polyData;
+    // Every frame replaces the points with the filtered ones, all of them frame the initial camera
+    polyData->SetPoints(options.scattered ? scatteredPositions.Get() : originalPositions.Get());
+    vtkNew<vtkPointGaussianMapper> pointMapper;
+    pointMapper->SetInputData(polyData);
+    pointMapper->EmissiveOff();
+    pointMapper->SetColorModeToDirectScalars();
+    pointMapper->SetScaleFactor(options.pointSize);
+    pointMapper->SetSplatShaderCode(
+#include "vis/shaders/_bilboard_fallback.frag"
+    );
+    vtkNew<vtkActor> pointActor;
+    pointActor->SetMapper(pointMapper);
+
+    EdgePipeline edges;
+    edges.instances.actor->SetVisibility(options.edges);
+
+    vtkNew<vtkRenderer> renderer;
+    renderer->AddActor(pointActor);
+    renderer->AddActor(edges.instances.actor);
+    renderer->SetBackground(namedColors->GetColor3d("White").GetData());
+
+    vtkCamera* camera = renderer->GetActiveCamera();
+    if (options.camera) {
+        auto& c = *options.camera;
+        camera->SetPosition(c[0], c[1], c[2]);
+        camera->SetFocalPoint(c[3], c[4], c[5]);
+        camera->SetViewUp(c[6], c[7], c[8]);
+        renderer->ResetCameraClippingRange();
+    }
+    else {
+        // Same initial view as the viewer
+        camera->Elevation(-90);
+        camera->SetViewUp(0, 0, 1);
+        renderer->ResetCamera();
+    }
+
+    vtkNew<vtkRenderWindow> renderWindow;
+    renderWindow->SetOffScreenRendering(true);
+    renderWindow->SetSize(options.width, options.height);
+    renderWindow->AddRenderer(renderer);
+
+    vtkNew<vtkWindowToImageFilter> capture;
+    capture->SetInput(renderWindow);
+    capture->SetInputBufferTypeToRGB();
+    capture->ReadFrontBufferOff();
+
+    std::ofstream raw;
+    if (!options.raw.empty()) {
+        raw.open(options.raw, std::ios::binary);
+        checkFile(raw);
+    }
+    else {
+        std::filesystem::create_directories(options.output);
+    }
+
+    std::vector<int> timesteps;
+    for (int t = options.first; t <= options.last; t += options.step) {
+        timesteps.push_back(t);
+    }
+
+    // Frames are loaded a few steps ahead, enough to keep every worker busy while one frame renders.
+    // Encoding goes before loading and at most `lookahead` frames wait for it, so memory stays bounded.
+    // The group is declared last, so an exception cancels and waits for its tasks before anything they use is destroyed.
+    std::atomic<int> queuedWrites = 0;
+    std::deque<std::future<Frame>> pending;
+    TaskGroup tasks;
+    size_t nextLoad = 0;
+    const size_t lookahead = 2 * workerCount();
+    auto scheduleLoads = [&]() {
+        while (nextLoad < timesteps.size() && pending.size() < lookahead) {
+            auto task = std::make_shared<std::packaged_task<Frame()>>([&, timestep = timesteps[nextLoad]]() {
+                return loadFrame(options, globalStatistics, positions, timestep);
+            });
+            pending.push_back(task->get_future());
+            tasks.submit([task]() { (*task)(); });
+            nextLoad++;
+        }
+    };
+
+    std::cout << std::format("Rendering {} frames of {} at {}x{}\n", timesteps.size(), attributeToString(options.attribute), options.width, options.height);
+
+    auto start = steady_clock::now();
+    duration<double> waiting{}, rendering{};
+    for (size_t i = 0; i < timesteps.size(); i++) {
+        scheduleLoads();
+        auto waitStart = steady_clock::now();
+        Frame frame = pending.front().get();
+        pending.pop_front();
+        scheduleLoads();
+        auto renderStart = steady_clock::now();
+        waiting += renderStart - waitStart;
+
+        polyData->SetPoints(frame.positions);
+        polyData->GetPointData()->SetScalars(frame.colors);
+        if (options.edges) {
+            edges.update(*aggregatedPoints, frame.timestep);
+        }
+        renderWindow->Render();
+        capture->Modified();
+        capture->Update();
+        rendering += steady_clock::now() - renderStart;
+
+        if (raw.is_open()) {
+            auto* image = capture->GetOutput();
+            auto* pixels = static_cast<const char*>(image->GetScalarPointer());
+            // VTK images start with the bottom row
+            const std::streamsize rowBytes = static_cast<std::streamsize>(options.width) * 3;
+            for (int row = options.height - 1; row >= 0; row--) {
+                raw.write(pixels + row * rowBytes, rowBytes);
+            }
+            checkFile(raw);
+        }
+        else {
+            vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+            image->DeepCopy(capture->GetOutput());
+            auto path = options.output / std::format("frame_{:05}.png", frame.timestep);
+            for (int count = queuedWrites; count >= static_cast<int>(lookahead); count = queuedWrites) {
+                queuedWrites.wait(count);
+            }
+            queuedWrites++;
+            tasks.submit([image, path, &queuedWrites]() {
+                vtkNew<vtkPNGWriter> writer;
+                writer->SetFileName(path.string().c_str());
+                writer->SetInputData(image);
+                writer->Write();
+                queuedWrites--;
+                queuedWrites.notify_all();
+            }, 1);
+        }
+
+        if ((i + 1) % 100 == 0) {
+            double seconds = duration<double>(steady_clock::now() - start).count();
+            std::cout << std::format("{} frames, {:.2f} fps\n", i + 1, (i + 1) / seconds);
+        }
+    }
+    tasks.wait();
+
+    double seconds = duration<double>(steady_clock::now() - start).count();
+    std::cout << std::format("{} frames in {:.2f} s: {:.2f} fps, {:.2f} ms rendering and {:.2f} ms waiting for data per frame\n",
+        timesteps.size(), seconds, timesteps.size() / seconds,
+        1000 * rendering.count() / timesteps.size(), 1000 * waiting.count() / timesteps.size());
+}
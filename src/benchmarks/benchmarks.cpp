@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <vtkNew.h>
+#include <vtkPoints.h>
+
+#include "utility.hpp"
+#include "syntheticData.hpp"
+#include "neuronProperties.hpp"
+#include "positionLayout.hpp"
+#include "vis/binaryReader.hpp"
+#include "vis/loaders.hpp"
+#include "vis/edgeInstances.hpp"
+
+// Micro and macro benchmarks of the loaders and parsers on a synthetic dataset.
+// Usage: BrainVisBenchmarks [iterations] [name filter]
+// Files are read repeatedly, so after the warm up iteration they come from the page cache.
+
+namespace {
+
+    struct Options {
+        int iterations = 10;
+        std::string filter;
+    };
+
+    class Benchmarks {
+        Options options;
+
+    public:
+        explicit Benchmarks(Options options) :
+            options(std::move(options))
+        {
+            std::cout << std::format("{:<44} {:>12} {:>12} {:>18}\n", "benchmark", "median", "p95", "throughput");
+        }
+
+        // Runs `body` once to warm up and then `iterations` times, `items` is the amount of work of one run in `unit`s
+        template<typename F>
+        void run(const std::string& name, double items, const char* unit, F&& body) {
+            if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+                return;
+            }
+
+            using namespace std::chrono;
+            body();
+
+            std::vector<double> seconds;
+            for (int i = 0; i < options.iterations; i++) {
+                auto start = steady_clock::now();
+                body();
+                seconds.push_back(duration<double>(steady_clock::now() - start).count());
+            }
+            std::sort(seconds.begin(), seconds.end());
+
+            double median = seconds[seconds.size() / 2];
+            if (seconds.size() % 2 == 0) {
+                median = (median + seconds[seconds.size() / 2 - 1]) / 2;
+            }
+            // Nearest rank percentile
+            size_t rank = static_cast<size_t>(std::ceil(0.95 * seconds.size()));
+            double p95 = seconds[std::clamp<size_t>(rank, 1, seconds.size()) - 1];
+
+            std::cout << std::format("{:<44} {:>9.3f} ms {:>9.3f} ms {:>11.4g} {}/s\n", name, median * 1000, p95 * 1000, items / median, unit);
+        }
+    };
+
+    // Keeps the optimizer from removing the benchmarked work
+    template<typename T>
+    void consume(const T& value) {
+        static volatile const void* sink;
+        sink = &value;
+    }
+
+    const std::vector<std::string> attributeFiles = {
+        "fired.txt", "firedFraction.txt", "electricActivity.txt", "secondaryVariable.txt", "calcium.txt", "targetCalcium.txt",
+        "synapticInput.txt", "backgroundActivity.txt", "grownAxons.txt", "connectedAxons.txt", "grownDendrites.txt", "connectedDendrites.txt"
+    };
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (argc > 1) options.iterations = std::max(1, std::stoi(argv[1]));
+    if (argc > 2) options.filter = argv[2];
+
+    // Sized like the SciVis 2023 dataset, the amount of timesteps and snapshots only needs to cover the benchmarks
+    synthetic::DatasetSize size{ .neuronCount = 50'000, .timestepCount = 16, .networkSnapshots = 2 };
+    synthetic::DatasetSize historySize = size;
+    historySize.timestepCount = 10'000;
+
+    auto folder = std::filesystem::temp_directory_path() / "brain-vis-benchmarks";
+    std::filesystem::remove_all(folder);
+    dataFolder = folder;
+
+    std::cout << "Writing synthetic dataset to " << folder << "\n";
+    synthetic::writePositions(folder, size);
+    writeDatasetDescriptor(folder, synthetic::descriptor(size));
+    synthetic::writeMonitorsBin(folder, size);
+    synthetic::writeNetworkBin(folder, size);
+    synthetic::writeHistograms(folder, historySize, attributeFiles);
+    {
+        // A single neuron with the full history for the text parser
+        synthetic::DatasetSize monitorSize = historySize;
+        monitorSize.neuronCount = 1;
+        synthetic::writeMonitors(folder, monitorSize);
+    }
+
+    Benchmarks benchmarks(options);
+    const double neuronBytes = static_cast<double>(size.neuronCount) * sizeof(NeuronProperties) / 1e6;
+
+    // Micro benchmarks
+
+    benchmarks.run("BinaryReader::read (one item)", neuronBytes, "MB", [&]() {
+        BinaryReader<NeuronProperties> reader(folder / "monitors-bin/timestep1");
+        float sum = 0;
+        for (size_t i = 0; i < reader.count(); i++) {
+            sum += reader.read().calcium;
+        }
+        consume(sum);
+    });
+
+    benchmarks.run("BinaryReader::read (span)", neuronBytes, "MB", [&]() {
+        BinaryReader<NeuronProperties> reader(folder / "monitors-bin/timestep1");
+        std::vector<NeuronProperties> neurons(reader.count());
+        reader.read(neurons);
+        consume(neurons);
+    });
+
+    benchmarks.run("PagedReader::read (span, cold)", neuronBytes, "MB", [&]() {
+        PageCache cache(64 << 20);
+        PagedReader<NeuronProperties> reader(folder / "monitors-bin/timestep1", 0, cache);
+        std::vector<NeuronProperties> neurons(reader.count());
+        reader.read(neurons);
+        consume(neurons);
+    });
+
+    benchmarks.run("PagedReader::read (span, cached)", neuronBytes, "MB", [&]() {
+        PagedReader<NeuronProperties> reader(folder / "monitors-bin/timestep1");
+        std::vector<NeuronProperties> neurons(reader.count());
+        reader.read(neurons);
+        consume(neurons);
+    });
+
+    benchmarks.run("NeuronProperties::parse", historySize.timestepCount, "lines", [&]() {
+        std::ifstream file(folder / "monitors/0_0.csv");
+        checkFile(file);
+        float sum = 0;
+        for (uint32_t t = 0; t < historySize.timestepCount; t++) {
+            sum += NeuronProperties::parse(file).calcium;
+        }
+        consume(sum);
+    });
+
+    benchmarks.run("parseCSV<int> (histogram)", historySize.timestepCount, "rows", [&]() {
+        auto rows = parseCSV<int, ' '>((folder / "monitors-hist-real/calcium.txt").string());
+        consume(rows);
+    });
+
+    benchmarks.run("parseCSV<double> (statistics)", historySize.timestepCount, "rows", [&]() {
+        auto rows = parseCSV<double, ' '>((folder / "monitors-histogram/calcium.txt").string());
+        consume(rows);
+    });
+
+    // Macro benchmarks
+
+    benchmarks.run("loadColors", size.neuronCount, "neurons", [&]() {
+        auto colors = loadColors(1, 4, 0, 1, Range::Whole(), false);
+        consume(colors);
+    });
+
+    benchmarks.run("loadColors (derivatives)", size.neuronCount, "neurons", [&]() {
+        auto colors = loadColors(1, 4, -0.1, 0.1, Range::Whole(), true);
+        consume(colors);
+    });
+
+    benchmarks.run("diffMinMax", size.neuronCount, "neurons", [&]() {
+        auto minMax = diffMinMax(1, 4);
+        consume(minMax);
+    });
+
+    double edgeCount = static_cast<double>(std::filesystem::file_size(folder / "network-bin/rank_0_step_0_in_network") / sizeof(Edge) - 1);
+    benchmarks.run("loadEdges", edgeCount, "edges", [&]() {
+        auto edges = loadEdges(0);
+        consume(edges);
+    });
+
+    benchmarks.run("loadPositions (text, computes layout)", size.neuronCount, "neurons", [&]() {
+        vtkNew<vtkPoints> original, scattered, aggregated;
+        std::vector<uint32_t> mapping;
+        loadPositions(*original, *scattered, *aggregated, mapping);
+        consume(mapping);
+    });
+
+    std::filesystem::create_directories((folder / positionLayoutPath).parent_path());
+    writePositionLayout(folder / positionLayoutPath, computePositionLayout(folder / "positions/rank_0_positions.txt"));
+
+    benchmarks.run("loadPositions (mapped layout)", size.neuronCount, "neurons", [&]() {
+        vtkNew<vtkPoints> original, scattered, aggregated;
+        std::vector<uint32_t> mapping;
+        loadPositions(*original, *scattered, *aggregated, mapping);
+        consume(mapping);
+    });
+
+    {
+        vtkNew<vtkPoints> original, scattered, aggregated;
+        std::vector<uint32_t> mapping;
+        loadPositions(*original, *scattered, *aggregated, mapping);
+        auto edges = loadEdges(0);
+        EdgeInstances instances;
+        benchmarks.run("EdgeInstances::update", static_cast<double>(edges.size()), "edges", [&]() {
+            instances.update(*aggregated, edges);
+        });
+        std::cout << std::format("{} edge instances in {:.2f} MiB\n", edges.size(), instances.memoryBytes() / double(1 << 20));
+    }
+
+    benchmarks.run("HistogramDataLoader (12 attributes)", 12, "attributes", [&]() {
+        HistogramDataLoader loader;
+        for (int i = 0; i < NeuronProperties::attributeCount; i++) {
+            consume(loader.getAttributeData(i));
+        }
+    });
+
+    std::filesystem::remove_all(folder);
+}
@@ -0,0 +1,363 @@
+#include "utility.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "datasetDescriptor.hpp"
+#include "edge.hpp"
+#include "edgeHierarchy.hpp"
+#include "positionLayout.hpp"
+#include "spatialIndex.hpp"
+
+// Clusters the edges of every network snapshot into an EdgeHierarchy.
+// Every cluster to cluster edge of network-bin becomes a 6D connexel weighted by its count, short connexels are
+// skipped, weighted k-means++ reduces them to at most `leafCount` clusters and nearest neighbour chain Ward linkage
+// builds the hierarchy over those. Memory stays linear in the number of edges, unlike pdist + linkage.
+
+namespace {
+
+    using Connexel = std::array<double, 6>;
+
+    // Same filter as python_scripts/modules/clustering.py
+    constexpr double minConnexelLength = 40;
+    constexpr int maxIterations = 30;
+
+    double dist2(const Connexel& a, const Connexel& b) {
+        double result = 0;
+        for (int i = 0; i < 6; i++) {
+            result += (a[i] - b[i]) * (a[i] - b[i]);
+        }
+        return result;
+    }
+
+    SpatialIndex::Point sourceOf(const Connexel& c) {
+        return { c[0], c[1], c[2] };
+    }
+
+    struct Connexels {
+        std::vector<Connexel> points;
+        std::vector<double> weights;
+    };
+
+    Connexels loadConnexels(const std::filesystem::path& path, std::span<const Position> clusterPositions) {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        checkFile(in);
+        auto fileSize = static_cast<size_t>(in.tellg());
+        EdgeFileHeader header{ 0, 0, 0 };
+        in.seekg(0);
+        if (fileSize >= sizeof(header)) {
+            in.read(reinterpret_cast<char*>(&header), sizeof(header));
+        }
+        checkEdgeFileHeader(header, path);
+        std::vector<Edge> edges(fileSize / sizeof(Edge) - 1);
+        in.read(reinterpret_cast<char*>(edges.data()), edges.size() * sizeof(Edge));
+        checkFile(in);
+
+        Connexels result;
+        for (auto& edge : edges) {
+            if (edge.from >= clusterPositions.size() || edge.to >= clusterPositions.size()) {
+                std::string msg = "File \"" + path.string() + "\" references cluster " + std::to_string(std::max(edge.from, edge.to))
+                    + " but the position layout has " + std::to_string(clusterPositions.size()) + ", rerun PreprocessNetwork.";
+                std::cout << msg << std::endl;
+                throw std::runtime_error{ msg };
+            }
+            auto& from = clusterPositions[edge.from];
+            auto& to = clusterPositions[edge.to];
+            Connexel c{ from[0], from[1], from[2], to[0], to[1], to[2] };
+            if (std::sqrt(SpatialIndex::dist2(sourceOf(c), { c[3], c[4], c[5] })) <= minConnexelLength) {
+                continue;
+            }
+            result.points.push_back(c);
+            result.weights.push_back(edge.weight);
+        }
+        return result;
+    }
+
+    struct KMeansResult {
+        std::vector<Connexel> centroids;
+        std::vector<double> weights;
+        std::vector<uint32_t> counts;
+    };
+
+    // Weighted k-means++ seeding followed by Lloyd iterations.
+    // The assignment step only tests centroids whose source position is closer than the current centroid,
+    // those are found with a spatial index over the source positions of the centroids.
+    KMeansResult kMeans(const Connexels& data, size_t k, std::mt19937& generator) {
+        size_t n = data.points.size();
+        k = std::min(k, n);
+        std::vector<Connexel> centroids;
+        std::vector<uint32_t> assignment(n, 0);
+        std::vector<double> nearest(n, INFINITY);
+
+        auto addCentroid = [&](size_t point) {
+            uint32_t index = static_cast<uint32_t>(centroids.size());
+            centroids.push_back(data.points[point]);
+            parallelFor(n, [&](size_t i) {
+                double d = dist2(data.points[i], centroids[index]);
+                if (d < nearest[i]) {
+                    nearest[i] = d;
+                    assignment[i] = index;
+                }
+            });
+        };
+
+        std::discrete_distribution<size_t> first(data.weights.begin(), data.weights.end());
+        addCentroid(first(generator));
+        while (centroids.size() < k) {
+            double total = 0;
+            for (size_t i = 0; i < n; i++) {
+                total += data.weights[i] * nearest[i];
+            }
+            if (total <= 0) break;
+
+            double target = std::uniform_real_distribution<double>(0, total)(generator);
+            size_t chosen = n - 1;
+            for (size_t i = 0; i < n; i++) {
+                target -= data.weights[i] * nearest[i];
+                if (target <= 0 && nearest[i] > 0) {
+                    chosen = i;
+                    break;
+                }
+            }
+            addCentroid(chosen);
+        }
+        k = centroids.size();
+
+        unsigned chunkCount = workerCount();
+        for (int iteration = 0; iteration < maxIterations; iteration++) {
+            // Update
+            std::vector<std::vector<Connexel>> sums(chunkCount, std::vector<Connexel>(k, Connexel{}));
+            std::vector<std::vector<double>> weights(chunkCount, std::vector<double>(k, 0));
+            parallelChunks(n, chunkCount, [&](unsigned chunk, size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    auto& sum = sums[chunk][assignment[i]];
+                    for (int axis = 0; axis < 6; axis++) {
+                        sum[axis] += data.weights[i] * data.points[i][axis];
+                    }
+                    weights[chunk][assignment[i]] += data.weights[i];
+                }
+            });
+            for (size_t c = 0; c < k; c++) {
+                Connexel sum{};
+                double weight = 0;
+                for (unsigned chunk = 0; chunk < chunkCount; chunk++) {
+                    for (int axis = 0; axis < 6; axis++) {
+                        sum[axis] += sums[chunk][c][axis];
+                    }
+                    weight += weights[chunk][c];
+                }
+                // Empty clusters keep their centroid
+                if (weight <= 0) continue;
+                for (int axis = 0; axis < 6; axis++) {
+                    centroids[c][axis] = sum[axis] / weight;
+                }
+            }
+
+            // Assignment
+            std::vector<SpatialIndex::Point> sources(k);
+            for (size_t c = 0; c < k; c++) {
+                sources[c] = sourceOf(centroids[c]);
+            }
+            SpatialIndex index(std::move(sources));
+
+            std::vector<size_t> changes(chunkCount, 0);
+            parallelChunks(n, chunkCount, [&](unsigned chunk, size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    auto& point = data.points[i];
+                    uint32_t best = assignment[i];
+                    double bestDistance = dist2(point, centroids[best]);
+                    for (uint32_t c : index.withinRadius(sourceOf(point), std::sqrt(bestDistance))) {
+                        double d = dist2(point, centroids[c]);
+                        if (d < bestDistance) {
+                            bestDistance = d;
+                            best = c;
+                        }
+                    }
+                    changes[chunk] += best != assignment[i];
+                    assignment[i] = best;
+                }
+            });
+
+            size_t changed = std::accumulate(changes.begin(), changes.end(), size_t{ 0 });
+            if (changed == 0) break;
+        }
+
+        KMeansResult result;
+        result.weights.assign(k, 0);
+        result.counts.assign(k, 0);
+        for (size_t i = 0; i < n; i++) {
+            result.weights[assignment[i]] += data.weights[i];
+            result.counts[assignment[i]]++;
+        }
+
+        // Drop clusters that lost all their connexels
+        size_t kept = 0;
+        for (size_t c = 0; c < k; c++) {
+            if (result.counts[c] == 0) continue;
+            centroids[kept] = centroids[c];
+            result.weights[kept] = result.weights[c];
+            result.counts[kept] = result.counts[c];
+            kept++;
+        }
+        centroids.resize(kept);
+        result.weights.resize(kept);
+        result.counts.resize(kept);
+        result.centroids = std::move(centroids);
+        return result;
+    }
+
+    EdgeClusterNode makeNode(const Connexel& centroid, double weight, uint32_t edgeCount) {
+        EdgeClusterNode node{};
+        for (int axis = 0; axis < 3; axis++) {
+            node.source[axis] = static_cast<float>(centroid[axis]);
+            node.target[axis] = static_cast<float>(centroid[axis + 3]);
+        }
+        node.weight = static_cast<float>(weight);
+        node.height = 0;
+        node.edgeCount = edgeCount;
+        return node;
+    }
+
+    // Nearest neighbour chain Ward linkage over weighted centroids, O(k^2) time and O(k) memory
+    EdgeHierarchy wardLinkage(const KMeansResult& leaves) {
+        size_t k = leaves.centroids.size();
+        EdgeHierarchy result;
+        result.header.leafCount = static_cast<uint32_t>(k);
+        for (size_t i = 0; i < k; i++) {
+            result.nodes.push_back(makeNode(leaves.centroids[i], leaves.weights[i], leaves.counts[i]));
+        }
+        if (k == 0) {
+            return result;
+        }
+
+        std::vector<Connexel> centroids = leaves.centroids;
+        std::vector<double> weights = leaves.weights;
+        std::vector<bool> active(k, true);
+
+        auto wardDistance = [&](size_t a, size_t b) {
+            return weights[a] * weights[b] / (weights[a] + weights[b]) * dist2(centroids[a], centroids[b]);
+        };
+
+        struct Merge {
+            uint32_t a;
+            uint32_t b;
+            double height;
+        };
+        std::vector<Merge> merges;
+        std::vector<uint32_t> chain;
+
+        for (size_t remaining = k; remaining > 1;) {
+            if (chain.empty()) {
+                chain.push_back(static_cast<uint32_t>(std::find(active.begin(), active.end(), true) - active.begin()));
+            }
+            uint32_t a = chain.back();
+            uint32_t previous = chain.size() >= 2 ? chain[chain.size() - 2] : UINT32_MAX;
+
+            // Prefer the previous chain element on ties, otherwise the chain could cycle
+            uint32_t b = previous;
+            double bestDistance = previous != UINT32_MAX ? wardDistance(a, previous) : INFINITY;
+            for (uint32_t c = 0; c < k; c++) {
+                if (!active[c] || c == a) continue;
+                double d = wardDistance(a, c);
+                if (d < bestDistance) {
+                    bestDistance = d;
+                    b = c;
+                }
+            }
+
+            if (b != previous) {
+                chain.push_back(b);
+                continue;
+            }
+
+            // Reciprocal nearest neighbours, b keeps the merged cluster
+            chain.pop_back();
+            chain.pop_back();
+            merges.push_back({ a, b, std::sqrt(2 * bestDistance) });
+            double weight = weights[a] + weights[b];
+            for (int axis = 0; axis < 6; axis++) {
+                centroids[b][axis] = (weights[a] * centroids[a][axis] + weights[b] * centroids[b][axis]) / weight;
+            }
+            weights[b] = weight;
+            active[a] = false;
+            remaining--;
+        }
+
+        // Sort by height and relabel with union find, like scipy
+        std::stable_sort(merges.begin(), merges.end(), [](auto& l, auto& r) { return l.height < r.height; });
+
+        std::vector<uint32_t> parent(k);
+        std::iota(parent.begin(), parent.end(), 0);
+        std::vector<uint32_t> nodeOf(k);
+        std::iota(nodeOf.begin(), nodeOf.end(), 0);
+        auto find = [&](uint32_t x) {
+            while (parent[x] != x) {
+                parent[x] = parent[parent[x]];
+                x = parent[x];
+            }
+            return x;
+        };
+
+        for (auto& merge : merges) {
+            uint32_t rootA = find(merge.a);
+            uint32_t rootB = find(merge.b);
+            auto& left = result.nodes[nodeOf[rootA]];
+            auto& right = result.nodes[nodeOf[rootB]];
+
+            double weight = static_cast<double>(left.weight) + right.weight;
+            Connexel centroid;
+            for (int axis = 0; axis < 3; axis++) {
+                centroid[axis] = (left.weight * left.source[axis] + right.weight * right.source[axis]) / weight;
+                centroid[axis + 3] = (left.weight * left.target[axis] + right.weight * right.target[axis]) / weight;
+            }
+            auto node = makeNode(centroid, weight, left.edgeCount + right.edgeCount);
+            node.height = static_cast<float>(merge.height);
+            node.left = static_cast<int32_t>(nodeOf[rootA]);
+            node.right = static_cast<int32_t>(nodeOf[rootB]);
+
+            parent[rootA] = rootB;
+            nodeOf[rootB] = static_cast<uint32_t>(result.nodes.size());
+            result.nodes.push_back(node);
+        }
+        result.header.nodeCount = static_cast<uint32_t>(result.nodes.size());
+        return result;
+    }
+
+}
+
+int main(int argc, char** argv) {
+    using namespace std::chrono;
+    setCurrentDirectory();
+    parseDataFolder(argc, argv);
+
+    size_t leafCount = argc > 1 ? std::stoul(argv[1]) : 512;
+
+    confirmOperation("Write \"yes\" if you want to remove all files in network-hierarchy and begin clustering.");
+
+    std::filesystem::remove_all(dataFolder / edgeHierarchyFolder);
+    std::filesystem::create_directory(dataFolder / edgeHierarchyFolder);
+
+    MappedPositionLayout layout(dataFolder / positionLayoutPath);
+    auto clusterPositions = layout.view().aggregated;
+
+    std::mt19937 generator(0);
+    const int snapshotCount = static_cast<int>(dataset().networkSnapshotCount);
+    for (int i = 0; i < snapshotCount; i++) {
+        auto start = steady_clock::now();
+        auto step = dataset().snapshotStep(i);
+
+        auto connexels = loadConnexels((dataFolder / "network-bin/rank_0_step_").string() + std::to_string(step) + "_in_network", clusterPositions);
+        auto hierarchy = connexels.points.empty() ? EdgeHierarchy{} : wardLinkage(kMeans(connexels, leafCount, generator));
+        hierarchy.header.step = static_cast<uint32_t>(step);
+        writeEdgeHierarchy(dataFolder / edgeHierarchyPath(step), hierarchy);
+
+        std::cout << i * 100 / snapshotCount << "% - " << connexels.points.size() << " connexels, " << hierarchy.header.leafCount << " leaves, "
+            << duration_cast<milliseconds>(steady_clock::now() - start) << "\n";
+    }
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "utility.hpp"
+
+// Sizes of a dataset, written to dataset.txt by the preprocessors and read once by the viewer,
+// so no tool has to assume the 50000 neurons and 10000 timesteps of the SciVis 2023 dataset.
+// Timesteps are the lines of the monitors, every one covers `stepsPerTimestep` simulation steps.
+struct DatasetDescriptor {
+    uint32_t neuronCount = 50'000;
+    uint32_t timestepCount = 10'000;
+    uint32_t stepsPerTimestep = 100;
+    uint32_t networkSnapshotCount = 100;
+    uint32_t stepsPerSnapshot = 10'000;
+
+    uint64_t simulationStep(int timestep) const {
+        return static_cast<uint64_t>(timestep) * stepsPerTimestep;
+    }
+
+    // Network snapshot shown at `timestep`, the last one for timesteps after it
+    int snapshotOf(int timestep) const {
+        uint64_t snapshot = simulationStep(timestep) / std::max(stepsPerSnapshot, 1u);
+        return static_cast<int>(std::min<uint64_t>(snapshot, std::max(networkSnapshotCount, 1u) - 1));
+    }
+
+    // Simulation step in the file names of a network snapshot
+    uint64_t snapshotStep(int snapshot) const {
+        return static_cast<uint64_t>(snapshot) * stepsPerSnapshot;
+    }
+};
+
+const std::filesystem::path datasetDescriptorPath = "dataset.txt";
+
+inline void writeDatasetDescriptor(const std::filesystem::path& folder, const DatasetDescriptor& descriptor) {
+    std::ofstream out(folder / datasetDescriptorPath);
+    checkFile(out);
+    out << "# Dataset descriptor, written by the preprocessors\n";
+    out << "neurons " << descriptor.neuronCount << "\n";
+    out << "timesteps " << descriptor.timestepCount << "\n";
+    out << "stepsPerTimestep " << descriptor.stepsPerTimestep << "\n";
+    out << "networkSnapshots " << descriptor.networkSnapshotCount << "\n";
+    out << "stepsPerSnapshot " << descriptor.stepsPerSnapshot << "\n";
+    checkFile(out);
+}
+
+inline DatasetDescriptor readDatasetDescriptor(const std::filesystem::path& folder) {
+    auto path = folder / datasetDescriptorPath;
+    std::ifstream in(path);
+    checkFile(in);
+
+    DatasetDescriptor result;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string key;
+        uint64_t value = 0;
+        if (!(fields >> key >> value) || value > UINT32_MAX) {
+            std::cout << "Invalid line \"" << line << "\" in " << path << std::endl;
+            throw std::runtime_error("Invalid dataset descriptor");
+        }
+        auto v = static_cast<uint32_t>(value);
+        if (key == "neurons") result.neuronCount = v;
+        else if (key == "timesteps") result.timestepCount = v;
+        else if (key == "stepsPerTimestep") result.stepsPerTimestep = v;
+        else if (key == "networkSnapshots") result.networkSnapshotCount = v;
+        else if (key == "stepsPerSnapshot") result.stepsPerSnapshot = v;
+        else std::cout << "Unknown key \"" << key << "\" in " << path << " ignored.\n";
+    }
+    return result;
+}
+
+// Derives the descriptor from the simulation output, or from preprocessed files where the output is missing.
+// Sizes that can't be determined keep the values of `known`, by default those of the SciVis 2023 dataset.
+inline DatasetDescriptor discoverDataset(const std::filesystem::path& folder, const DatasetDescriptor& known = {}) {
+    DatasetDescriptor result = known;
+
+    auto countLines = [](const std::filesystem::path& path) {
+        std::ifstream in(path);
+        checkFile(in);
+        uint32_t count = 0;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line[0] != '#') count++;
+        }
+        return count;
+    };
+
+    if (auto positions = folder / "positions/rank_0_positions.txt"; std::filesystem::exists(positions)) {
+        result.neuronCount = countLines(positions);
+    }
+
+    if (auto monitor = folder / "monitors/0_0.csv"; std::filesystem::exists(monitor)) {
+        result.timestepCount = countLines(monitor);
+        // Every line starts with its simulation step
+        std::ifstream in(monitor);
+        uint64_t first = 0, second = 0;
+        std::string rest;
+        if (in >> first && std::getline(in, rest) && in >> second && second > first) {
+            result.stepsPerTimestep = static_cast<uint32_t>(second - first);
+        }
+    }
+    else if (std::filesystem::exists(folder / "monitors-bin")) {
+        result.timestepCount = static_cast<uint32_t>(std::distance(std::filesystem::directory_iterator(folder / "monitors-bin"), {}));
+    }
+
+    for (auto network : { "network", "network-bin" }) {
+        if (!std::filesystem::exists(folder / network)) continue;
+
+        const std::regex snapshotName(R"(rank_0_step_(\d+)_in_network(\.txt)?)");
+        std::vector<uint64_t> steps;
+        for (auto& entry : std::filesystem::directory_iterator(folder / network)) {
+            std::smatch match;
+            auto name = entry.path().filename().string();
+            if (std::regex_match(name, match, snapshotName)) {
+                steps.push_back(std::stoull(match[1].str()));
+            }
+        }
+        if (steps.empty()) continue;
+
+        std::sort(steps.begin(), steps.end());
+        result.networkSnapshotCount = static_cast<uint32_t>(steps.size());
+        if (steps.size() > 1) {
+            result.stepsPerSnapshot = static_cast<uint32_t>(steps[1] - steps[0]);
+        }
+        break;
+    }
+    return result;
+}
+
+// Called by the preprocessors, so the descriptor matches the data they read. Sizes whose input isn't in the folder
+// (e.g. the monitors when only the network is preprocessed) keep the values of the existing descriptor.
+inline DatasetDescriptor updateDatasetDescriptor(const std::filesystem::path& folder) {
+    auto existing = std::filesystem::exists(folder / datasetDescriptorPath) ? readDatasetDescriptor(folder) : DatasetDescriptor{};
+    auto descriptor = discoverDataset(folder, existing);
+    writeDatasetDescriptor(folder, descriptor);
+    std::cout << "Dataset: " << descriptor.neuronCount << " neurons, " << descriptor.timestepCount << " timesteps, "
+        << descriptor.networkSnapshotCount << " network snapshots\n";
+    return descriptor;
+}
+
+// Descriptor of `dataFolder`, read on first use
+inline const DatasetDescriptor& dataset() {
+    static const DatasetDescriptor descriptor = []() {
+        if (std::filesystem::exists(dataFolder / datasetDescriptorPath)) {
+            return readDatasetDescriptor(dataFolder);
+        }
+        std::cout << "File " << dataFolder / datasetDescriptorPath << " doesn't exist, run the preprocessors to create it.\n";
+        return discoverDataset(dataFolder);
+    }();
+    return descriptor;
+}
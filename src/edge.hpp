@@ -2,14 +2,49 @@
 #include <cstdint>
 #include <cstddef>
 #include <bit>
+#include <filesystem>
 #include <fstream>
+#include <span>
+#include <string>
 
+#include "utility.hpp"
+
+// Cluster to cluster edge of a network snapshot, `weight` is the number of neuron edges between the clusters
 struct Edge {
-	uint16_t from;
-	uint16_t to;
-	uint16_t weight;
+	uint32_t from;
+	uint32_t to;
+	uint32_t weight;
+};
+
+// Start of network-bin/rank_0_step_<step>_in_network, followed by the edges sorted by descending weight.
+// It has the size of one edge, so the files can be read as an array of edges starting with the header.
+struct EdgeFileHeader {
+	static constexpr uint32_t expectedMagic = 0x47444542; // "BEDG"
+	static constexpr uint32_t expectedVersion = 2;
+
+	uint32_t magic = expectedMagic;
+	uint32_t version = expectedVersion;
+	uint32_t reserved = 0;
 };
 
 
-static_assert(sizeof(Edge) == 3 * sizeof(uint16_t));
+static_assert(sizeof(Edge) == 3 * sizeof(uint32_t));
+static_assert(sizeof(EdgeFileHeader) == sizeof(Edge));
 static_assert(std::endian::native == std::endian::little);
+
+inline void checkEdgeFileHeader(const EdgeFileHeader& header, const std::filesystem::path& path) {
+	if (header.magic != EdgeFileHeader::expectedMagic || header.version != EdgeFileHeader::expectedVersion) {
+		std::string msg = "File \"" + path.string() + "\" is not a supported edge file, rerun PreprocessNetwork.";
+		std::cout << msg << std::endl;
+		throw std::runtime_error{ msg };
+	}
+}
+
+inline void writeEdges(const std::filesystem::path& path, std::span<const Edge> edges) {
+	std::ofstream out(path, std::ios::binary);
+	checkFile(out);
+	EdgeFileHeader header;
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(edges.data()), edges.size_bytes());
+	checkFile(out);
+}
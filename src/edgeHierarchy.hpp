@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "utility.hpp"
+
+// Ward hierarchy of connexels (source and target position of an edge as one 6D point) written by ClusterNetwork.
+// Leaves are k-means clusters of the edges of one network snapshot, every following node merges two earlier
+// nodes and merges are sorted by height, the same order as scipy linkage.
+//
+// File layout: EdgeHierarchyHeader, EdgeClusterNode[nodeCount]
+
+struct EdgeHierarchyHeader {
+    static constexpr uint32_t expectedMagic = 0x52494845; // "EHIR"
+    static constexpr uint32_t expectedVersion = 1;
+
+    uint32_t magic = expectedMagic;
+    uint32_t version = expectedVersion;
+    uint32_t leafCount = 0;
+    uint32_t nodeCount = 0;
+    uint32_t step = 0;
+    uint32_t reserved = 0;
+};
+
+struct EdgeClusterNode {
+    // Weighted centroid of the connexels in the node
+    std::array<float, 3> source;
+    std::array<float, 3> target;
+    // Sum of edge counts
+    float weight;
+    // Ward distance at which the children were merged, 0 for leaves
+    float height;
+    int32_t left = -1;
+    int32_t right = -1;
+    // Number of distinct cluster to cluster edges in the node
+    uint32_t edgeCount;
+    uint32_t reserved = 0;
+
+    bool isLeaf() const { return left == -1; }
+};
+
+static_assert(sizeof(EdgeHierarchyHeader) == 6 * 4);
+static_assert(sizeof(EdgeClusterNode) == 12 * 4);
+
+const std::filesystem::path edgeHierarchyFolder = "network-hierarchy";
+
+inline std::filesystem::path edgeHierarchyPath(uint64_t step) {
+    return edgeHierarchyFolder / ("rank_0_step_" + std::to_string(step) + "_in_network");
+}
+
+struct EdgeHierarchy {
+    EdgeHierarchyHeader header;
+    std::vector<EdgeClusterNode> nodes;
+
+    bool empty() const { return nodes.empty(); }
+
+    // Nodes of the cut of the hierarchy into at most `clusterCount` clusters
+    std::vector<uint32_t> cut(size_t clusterCount) const {
+        std::vector<uint32_t> result;
+        if (nodes.empty() || clusterCount == 0) {
+            return result;
+        }
+
+        // Undo the highest merges, they are stored last
+        std::vector<bool> inCut(nodes.size(), false);
+        size_t count = 1;
+        inCut.back() = true;
+        for (size_t i = nodes.size() - 1; i >= header.leafCount && count < clusterCount; i--) {
+            inCut[i] = false;
+            inCut[nodes[i].left] = true;
+            inCut[nodes[i].right] = true;
+            count++;
+        }
+
+        for (uint32_t i = 0; i < nodes.size(); i++) {
+            if (inCut[i]) result.push_back(i);
+        }
+        return result;
+    }
+};
+
+inline void writeEdgeHierarchy(const std::filesystem::path& path, const EdgeHierarchy& hierarchy) {
+    std::ofstream out(path, std::ios::binary);
+    checkFile(out);
+    out.write(reinterpret_cast<const char*>(&hierarchy.header), sizeof(hierarchy.header));
+    out.write(reinterpret_cast<const char*>(hierarchy.nodes.data()), hierarchy.nodes.size() * sizeof(EdgeClusterNode));
+    checkFile(out);
+}
+
+inline EdgeHierarchy readEdgeHierarchy(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    checkFile(in);
+
+    EdgeHierarchy result;
+    in.read(reinterpret_cast<char*>(&result.header), sizeof(result.header));
+    checkFile(in);
+    if (result.header.magic != EdgeHierarchyHeader::expectedMagic || result.header.version != EdgeHierarchyHeader::expectedVersion) {
+        std::string msg = "File \"" + path.string() + "\" is not a supported edge hierarchy, rerun ClusterNetwork.";
+        std::cout << msg << std::endl;
+        throw std::runtime_error{ msg };
+    }
+
+    result.nodes.resize(result.header.nodeCount);
+    in.read(reinterpret_cast<char*>(result.nodes.data()), result.nodes.size() * sizeof(EdgeClusterNode));
+    checkFile(in);
+    return result;
+}
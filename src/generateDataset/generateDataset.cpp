@@ -0,0 +1,118 @@
+#include "utility.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "syntheticData.hpp"
+
+// Writes a synthetic dataset in the input format of the SciVis 2023 simulation, so the preprocessors and the
+// viewer can be run at other scales than the 50000 neuron dataset.
+// Usage: GenerateDataset [--output folder] [--neurons N] [--timesteps T] [--snapshots S]
+//                        [--neurons-per-cluster K] [--edges-per-neuron E] [--extent X]
+// Clustering density is the amount of neurons per position cluster, edge density the amount of incoming
+// edges per neuron and snapshot. Without --extent the box grows with the cluster count so clusters stay as
+// far apart as in the default dataset.
+
+namespace {
+
+    struct Options {
+        std::filesystem::path output = dataFolder;
+        synthetic::DatasetSize size;
+        bool extentSet = false;
+        bool snapshotsSet = false;
+    };
+
+    uint32_t parseCount(std::string_view name, const char* value) {
+        auto result = std::stoul(value);
+        if (result == 0 || result > std::numeric_limits<uint32_t>::max()) {
+            std::cout << name << " must be between 1 and " << std::numeric_limits<uint32_t>::max() << std::endl;
+            throw std::runtime_error("Invalid argument");
+        }
+        return static_cast<uint32_t>(result);
+    }
+
+    Options parseOptions(int argc, char** argv) {
+        Options options;
+        for (int i = 1; i < argc; i += 2) {
+            std::string_view name = argv[i];
+            if (i + 1 >= argc) {
+                std::cout << "Missing value of " << name << std::endl;
+                throw std::runtime_error("Invalid argument");
+            }
+            const char* value = argv[i + 1];
+
+            if (name == "--output") {
+                options.output = value;
+            } else if (name == "--neurons") {
+                options.size.neuronCount = parseCount(name, value);
+            } else if (name == "--timesteps") {
+                options.size.timestepCount = parseCount(name, value);
+            } else if (name == "--snapshots") {
+                options.size.networkSnapshots = parseCount(name, value);
+                options.snapshotsSet = true;
+            } else if (name == "--neurons-per-cluster") {
+                options.size.neuronsPerCluster = parseCount(name, value);
+            } else if (name == "--edges-per-neuron") {
+                options.size.edgesPerNeuron = parseCount(name, value);
+            } else if (name == "--extent") {
+                options.size.extent = std::stod(value);
+                options.extentSet = true;
+            } else {
+                std::cout << "Unknown option " << name << std::endl;
+                throw std::runtime_error("Invalid argument");
+            }
+        }
+
+        auto& size = options.size;
+        // The simulation writes monitors every 100 steps and the network every 10000 steps
+        if (!options.snapshotsSet) {
+            size.networkSnapshots = std::max(1u, size.timestepCount / 100);
+        }
+        if (!options.extentSet) {
+            double clusterCount = std::ceil(static_cast<double>(size.neuronCount) / size.neuronsPerCluster);
+            size.extent = 200 * std::cbrt(clusterCount / 10'000);
+        }
+        return options;
+    }
+}
+
+int main(int argc, char** argv) {
+    using namespace std::chrono;
+    setCurrentDirectory();
+
+    auto options = parseOptions(argc, argv);
+    const auto& size = options.size;
+
+    uint64_t clusterCount = (static_cast<uint64_t>(size.neuronCount) + size.neuronsPerCluster - 1) / size.neuronsPerCluster;
+    std::cout << "Dataset: " << size.neuronCount << " neurons, " << size.timestepCount << " timesteps, "
+        << size.networkSnapshots << " network snapshots, " << size.edgesPerNeuron << " edges per neuron, about "
+        << clusterCount << " clusters in a " << size.extent << "^3 box" << std::endl;
+
+    std::string msg = "Write \"yes\" if you want to remove positions, monitors and network in " + options.output.string() + " and generate the dataset.";
+    confirmOperation(msg.c_str());
+
+    for (auto folder : { "positions", "monitors", "network" }) {
+        std::filesystem::remove_all(options.output / folder);
+    }
+
+    auto start = high_resolution_clock::now();
+    auto report = [&](const char* name) {
+        std::cout << name << " written after " << duration_cast<seconds>(high_resolution_clock::now() - start).count() << "s" << std::endl;
+    };
+
+    synthetic::writePositions(options.output, size);
+    report("Positions");
+    synthetic::writeNetwork(options.output, size);
+    report("Network");
+    synthetic::writeMonitors(options.output, size);
+    report("Monitors");
+    writeDatasetDescriptor(options.output, synthetic::descriptor(size));
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+    const std::byte* data = nullptr;
+    size_t byteSize = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+
+    [[noreturn]] static void fail(const std::filesystem::path& path, const char* what) {
+        std::string msg = "File \"" + path.string() + "\" " + what;
+        std::cout << msg << std::endl;
+        throw std::runtime_error{ msg };
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (data) UnmapViewOfFile(data);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data) munmap(const_cast<std::byte*>(data), byteSize);
+        if (fd != -1) ::close(fd);
+        fd = -1;
+#endif
+        data = nullptr;
+        byteSize = 0;
+    }
+
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(const std::filesystem::path& path) {
+        byteSize = std::filesystem::exists(path) ? std::filesystem::file_size(path) : 0;
+#ifdef _WIN32
+        file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            fail(path, "couldn't be opened!");
+        }
+        if (byteSize == 0) return;
+        mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            close();
+            fail(path, "couldn't be mapped!");
+        }
+        data = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1) {
+            fail(path, "couldn't be opened!");
+        }
+        if (byteSize == 0) return;
+        void* ptr = mmap(nullptr, byteSize, PROT_READ, MAP_SHARED, fd, 0);
+        data = ptr == MAP_FAILED ? nullptr : static_cast<const std::byte*>(ptr);
+        // The mapping stays valid without the descriptor, so many files can be mapped at once
+        ::close(fd);
+        fd = -1;
+#endif
+        if (!data) {
+            close();
+            fail(path, "couldn't be mapped!");
+        }
+    }
+
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            std::swap(data, other.data);
+            std::swap(byteSize, other.byteSize);
+#ifdef _WIN32
+            std::swap(file, other.file);
+            std::swap(mapping, other.mapping);
+#else
+            std::swap(fd, other.fd);
+#endif
+        }
+        return *this;
+    }
+
+    size_t size() const { return byteSize; }
+
+    std::span<const std::byte> bytes() const { return { data, byteSize }; }
+
+    // View of `count` items of type T starting at `byteOffset`
+    template<typename T>
+    std::span<const T> view(size_t byteOffset, size_t count) const {
+        if (byteOffset + count * sizeof(T) > byteSize) {
+            throw std::runtime_error{ "Mapped file is too small!" };
+        }
+        return { reinterpret_cast<const T*>(data + byteOffset), count };
+    }
+};
@@ -0,0 +1,273 @@
+#include "utility.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "datasetDescriptor.hpp"
+
+// Merges the output of a simulation that ran on several MPI ranks into the single rank layout the preprocessors
+// and the viewer read. Every rank writes positions/rank_<r>_positions.txt, network/rank_<r>_step_<s>_in_network.txt
+// and monitors/<r>_<local id>.csv with ids local to the rank. Neurons are numbered globally in rank order, so the
+// global id is the number of neurons on the lower ranks plus the local id.
+// Usage: MergeRanks --input folder [--output folder] [--data folder], --output defaults to the data folder.
+// Ranks are read concurrently, monitors are hard linked into the output when both folders are on the same drive.
+
+namespace {
+
+    struct Options {
+        std::filesystem::path input;
+        std::filesystem::path output = dataFolder;
+    };
+
+    Options parseOptions(int argc, char** argv) {
+        Options options;
+        for (int i = 1; i < argc; i += 2) {
+            std::string_view name = argv[i];
+            if (i + 1 >= argc) {
+                std::cout << "Missing value of " << name << std::endl;
+                throw std::runtime_error("Invalid argument");
+            }
+            if (name == "--input") options.input = argv[i + 1];
+            else if (name == "--output") options.output = argv[i + 1];
+            else {
+                std::cout << "Unknown option " << name << std::endl;
+                throw std::runtime_error("Invalid argument");
+            }
+        }
+        if (options.input.empty()) {
+            std::cout << "--input is required" << std::endl;
+            throw std::runtime_error("Invalid argument");
+        }
+        if (std::filesystem::weakly_canonical(options.input) == std::filesystem::weakly_canonical(options.output)) {
+            std::cout << "Input and output have to be different folders" << std::endl;
+            throw std::runtime_error("Invalid argument");
+        }
+        return options;
+    }
+
+    // Numbers captured by the first group of `pattern` in the file names of `folder`, sorted
+    std::vector<uint64_t> findNumbers(const std::filesystem::path& folder, const std::regex& pattern) {
+        std::vector<uint64_t> result;
+        if (!std::filesystem::exists(folder)) {
+            return result;
+        }
+        for (auto& entry : std::filesystem::directory_iterator(folder)) {
+            std::smatch match;
+            auto name = entry.path().filename().string();
+            if (std::regex_match(name, match, pattern)) {
+                result.push_back(std::stoull(match[1].str()));
+            }
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    bool isComment(std::string_view line) {
+        return line.empty() || line[0] == '#';
+    }
+
+    // Parses the next whitespace separated integer of `line` starting at `it`
+    template<typename T>
+    T parseField(std::string_view line, const char*& it) {
+        const char* end = line.data() + line.size();
+        while (it != end && (*it == ' ' || *it == '\t')) it++;
+        T value{};
+        auto [next, error] = std::from_chars(it, end, value);
+        if (error != std::errc()) {
+            throw std::runtime_error{ "Invalid row: " + std::string(line) };
+        }
+        it = next;
+        return value;
+    }
+
+    std::filesystem::path positionsPath(const std::filesystem::path& folder, uint32_t rank) {
+        return folder / "positions" / ("rank_" + std::to_string(rank) + "_positions.txt");
+    }
+
+    std::filesystem::path networkPath(const std::filesystem::path& folder, uint32_t rank, uint64_t step) {
+        return folder / "network" / ("rank_" + std::to_string(rank) + "_step_" + std::to_string(step) + "_in_network.txt");
+    }
+
+    // Local ids of the positions start at 1, so the highest one is the neuron count of the rank
+    uint32_t countNeurons(const std::filesystem::path& path) {
+        std::ifstream in(path);
+        checkFile(in);
+        uint32_t result = 0;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (isComment(line)) continue;
+            const char* it = line.data();
+            result = std::max(result, parseField<uint32_t>(line, it));
+        }
+        return result;
+    }
+
+    // Rows of a positions file with the local id replaced by the global one, the remaining columns are kept
+    std::string remapPositions(const std::filesystem::path& path, uint32_t offset) {
+        std::ifstream in(path);
+        checkFile(in);
+        std::string result;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (isComment(line)) continue;
+            const char* it = line.data();
+            result += std::to_string(offset + parseField<uint32_t>(line, it));
+            result.append(line, it - line.data());
+            result += '\n';
+        }
+        return result;
+    }
+
+    // Edges of one rank with global ids, every endpoint is remapped with the offset of the rank it lives on
+    void appendNetwork(const std::filesystem::path& path, const std::vector<uint32_t>& offsets, std::ofstream& out) {
+        std::ifstream in(path);
+        checkFile(in);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (isComment(line)) continue;
+            const char* it = line.data();
+            auto targetRank = parseField<uint32_t>(line, it);
+            auto target = parseField<uint32_t>(line, it);
+            auto sourceRank = parseField<uint32_t>(line, it);
+            auto source = parseField<uint32_t>(line, it);
+            auto weight = parseField<int>(line, it);
+            if (targetRank >= offsets.size() || sourceRank >= offsets.size()) {
+                std::cout << "Rank out of range in " << path << ": " << line << std::endl;
+                throw std::runtime_error("Invalid network file");
+            }
+            out << "0 " << offsets[targetRank] + target << " 0 " << offsets[sourceRank] + source << ' ' << weight << '\n';
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    using namespace std::chrono;
+    setCurrentDirectory();
+    parseDataFolder(argc, argv);
+    auto options = parseOptions(argc, argv);
+    const auto& input = options.input;
+    const auto& output = options.output;
+
+    auto ranks = findNumbers(input / "positions", std::regex(R"(rank_(\d+)_positions\.txt)"));
+    if (ranks.empty()) {
+        std::cout << "No positions/rank_<r>_positions.txt files in " << input << std::endl;
+        throw std::runtime_error("No ranks found");
+    }
+    const auto rankCount = static_cast<uint32_t>(ranks.size());
+    if (ranks.back() != rankCount - 1) {
+        std::cout << "Ranks have to be numbered from 0 without gaps, " << rankCount << " found up to rank " << ranks.back() << std::endl;
+        throw std::runtime_error("Missing ranks");
+    }
+
+    // Every rank writes the same network snapshots
+    auto steps = findNumbers(input / "network", std::regex(R"(rank_0_step_(\d+)_in_network\.txt)"));
+    for (uint32_t rank = 1; rank < rankCount; rank++) {
+        for (auto step : steps) {
+            if (!std::filesystem::exists(networkPath(input, rank, step))) {
+                std::cout << "File " << networkPath(input, rank, step) << " is missing" << std::endl;
+                throw std::runtime_error("Missing network snapshot");
+            }
+        }
+    }
+    std::cout << rankCount << " ranks, " << steps.size() << " network snapshots" << std::endl;
+
+    std::string msg = "Write \"yes\" if you want to remove positions, monitors and network in " + output.string() + " and merge the ranks.";
+    confirmOperation(msg.c_str());
+
+    for (auto folder : { "positions", "monitors", "network" }) {
+        std::filesystem::remove_all(output / folder);
+        std::filesystem::create_directories(output / folder);
+    }
+
+    auto start = steady_clock::now();
+    auto report = [&](const char* name) {
+        std::cout << name << " merged after " << duration_cast<duration<double>>(steady_clock::now() - start) << std::endl;
+    };
+
+    // Positions, ids are remapped in a second pass once the offsets of all ranks are known
+    std::vector<uint32_t> neuronCounts(rankCount);
+    parallelFor(rankCount, [&](size_t rank) {
+        neuronCounts[rank] = countNeurons(positionsPath(input, static_cast<uint32_t>(rank)));
+    });
+    std::vector<uint32_t> offsets(rankCount);
+    uint64_t neuronCount = 0;
+    for (uint32_t rank = 0; rank < rankCount; rank++) {
+        offsets[rank] = static_cast<uint32_t>(neuronCount);
+        neuronCount += neuronCounts[rank];
+    }
+    if (neuronCount > UINT32_MAX) {
+        throw std::runtime_error("More than 2^32 neurons");
+    }
+    std::vector<std::string> positions(rankCount);
+    parallelFor(rankCount, [&](size_t rank) {
+        positions[rank] = remapPositions(positionsPath(input, static_cast<uint32_t>(rank)), offsets[rank]);
+    });
+    {
+        std::ofstream out(positionsPath(output, 0));
+        checkFile(out);
+        out << "# Merged from " << rankCount << " ranks\n# <global id> <pos x> <pos y> <pos z> <area> <type>\n";
+        for (auto& rows : positions) {
+            out << rows;
+        }
+        checkFile(out);
+    }
+    positions = {};
+    report("Positions");
+
+    // Network snapshots, one output file per step with the edges of all ranks in rank order
+    parallelFor(steps.size(), [&](size_t i) {
+        std::ofstream out(networkPath(output, 0, steps[i]));
+        checkFile(out);
+        out << "# Merged from " << rankCount << " ranks\n";
+        out << "# <target rank> <target neuron id> <source rank> <source neuron id> <weight>\n";
+        for (uint32_t rank = 0; rank < rankCount; rank++) {
+            appendNetwork(networkPath(input, rank, steps[i]), offsets, out);
+        }
+        checkFile(out);
+    });
+    report("Network");
+
+    // Monitors are only renamed, their rows don't contain ids. Local monitor ids start at 0.
+    // Every neuron needs one, the viewer reads the monitors of all neurons.
+    std::vector<std::vector<std::filesystem::path>> missing(rankCount);
+    parallelFor(rankCount, [&](size_t rank) {
+        for (uint32_t local = 0; local < neuronCounts[rank]; local++) {
+            auto from = input / "monitors" / (std::to_string(rank) + "_" + std::to_string(local) + ".csv");
+            auto to = output / "monitors" / ("0_" + std::to_string(offsets[rank] + local) + ".csv");
+            if (!std::filesystem::exists(from)) {
+                missing[rank].push_back(from);
+                continue;
+            }
+            std::error_code error;
+            std::filesystem::create_hard_link(from, to, error);
+            if (error) {
+                std::filesystem::copy_file(from, to);
+            }
+        }
+    });
+    size_t missingCount = 0;
+    for (auto& files : missing) {
+        for (auto& file : files) {
+            if (missingCount++ < 10) {
+                std::cout << "File " << file << " is missing" << std::endl;
+            }
+        }
+    }
+    if (missingCount > 0) {
+        std::cout << missingCount << " of " << neuronCount << " monitor files are missing" << std::endl;
+        throw std::runtime_error("Missing monitors");
+    }
+    report("Monitors");
+
+    updateDatasetDescriptor(output);
+}
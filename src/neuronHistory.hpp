@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+
+#include "mappedFile.hpp"
+#include "neuronProperties.hpp"
+
+// Neuron-major copy of monitors-bin written by PreprocessNeuronProperties.
+// Every attribute has its own file with a NeuronHistoryHeader followed by float[neuronCount][timestepCount],
+// so the whole history of one attribute of one neuron is a single contiguous range.
+
+struct NeuronHistoryHeader {
+    static constexpr uint32_t expectedMagic = 0x5453484E; // "NHST"
+
+    uint32_t magic = expectedMagic;
+    uint32_t neuronCount = 0;
+    uint32_t timestepCount = 0;
+    uint32_t attribute = 0;
+};
+
+static_assert(sizeof(NeuronHistoryHeader) == 4 * 4);
+
+const std::filesystem::path neuronHistoryFolder = "monitors-neuron";
+
+inline std::filesystem::path neuronHistoryPath(int attribute) {
+    return neuronHistoryFolder / ("attribute" + std::to_string(attribute));
+}
+
+// Lazily memory maps the per-attribute history files
+class NeuronHistoryStore {
+    struct AttributeFile {
+        MappedFile file;
+        NeuronHistoryHeader header;
+        std::span<const float> values;
+    };
+
+    std::filesystem::path folder;
+    std::array<std::unique_ptr<AttributeFile>, NeuronProperties::attributeCount> attributes;
+    std::array<bool, NeuronProperties::attributeCount> missing{};
+    std::mutex mutex;
+
+    const AttributeFile* open(int attribute) {
+        std::lock_guard lock(mutex);
+        if (attributes[attribute] || missing[attribute]) {
+            return attributes[attribute].get();
+        }
+
+        auto path = folder / neuronHistoryPath(attribute);
+        if (!std::filesystem::exists(path)) {
+            std::cout << "File " << path << " doesn't exist, run PreprocessNeuronProperties to create neuron histories.\n";
+            missing[attribute] = true;
+            return nullptr;
+        }
+
+        auto result = std::make_unique<AttributeFile>();
+        result->file = MappedFile(path);
+        result->header = result->file.view<NeuronHistoryHeader>(0, 1)[0];
+        if (result->header.magic != NeuronHistoryHeader::expectedMagic) {
+            std::cout << "File " << path << " is not a neuron history file.\n";
+            missing[attribute] = true;
+            return nullptr;
+        }
+        size_t count = size_t{ result->header.neuronCount } * result->header.timestepCount;
+        result->values = result->file.view<float>(sizeof(NeuronHistoryHeader), count);
+
+        attributes[attribute] = std::move(result);
+        return attributes[attribute].get();
+    }
+
+public:
+    explicit NeuronHistoryStore(std::filesystem::path folder) :
+        folder(std::move(folder)) { }
+
+    bool isAvailable(int attribute) {
+        return open(attribute) != nullptr;
+    }
+
+    // All timesteps of one attribute of one neuron, empty if the history wasn't preprocessed
+    std::span<const float> history(int attribute, uint32_t neuron) {
+        auto* file = open(attribute);
+        if (!file || neuron >= file->header.neuronCount) {
+            return {};
+        }
+        return file->values.subspan(size_t{ neuron } * file->header.timestepCount, file->header.timestepCount);
+    }
+
+    // Whole neuron-major table of one attribute, empty if the history wasn't preprocessed
+    std::span<const float> table(int attribute) {
+        auto* file = open(attribute);
+        return file ? file->values : std::span<const float>{};
+    }
+
+    // Size of the mapped files, resident pages are a part of it
+    size_t mappedBytes() {
+        std::lock_guard lock(mutex);
+        size_t result = 0;
+        for (auto& attribute : attributes) {
+            if (attribute) result += attribute->values.size_bytes();
+        }
+        return result;
+    }
+
+    uint32_t timestepCount(int attribute) {
+        auto* file = open(attribute);
+        return file ? file->header.timestepCount : 0;
+    }
+};
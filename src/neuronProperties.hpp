@@ -20,6 +20,9 @@ struct NeuronProperties {
     float grownDendrites;
     uint32_t connectedDendrites;
 
+    // Fixed by the record layout, unlike the sizes of a dataset
+    static constexpr int attributeCount = 12;
+
     static NeuronProperties parse(std::ifstream& stream) {
         NeuronProperties result{};
 
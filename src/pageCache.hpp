@@ -0,0 +1,245 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "utility.hpp"
+#include "workerPool.hpp"
+
+// Fixed size pages of read-only files kept in memory up to a capacity, the least recently used pages are evicted first.
+// Pages are read on demand or ahead of time on the shared worker pool, so the working set of the loaders stays bounded
+// regardless of the size of the dataset. Pages stay valid for readers holding them after they were evicted.
+class PageCache {
+public:
+    using Page = std::shared_ptr<const std::vector<std::byte>>;
+    using FileId = uint32_t;
+    static constexpr size_t defaultPageSize = 1 << 20;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t readahead = 0;
+    };
+
+private:
+    struct Key {
+        FileId file;
+        uint64_t page;
+        bool operator==(const Key&) const = default;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return std::hash<uint64_t>()(key.page * 0x9E3779B97F4A7C15ull ^ key.file);
+        }
+    };
+
+    struct Entry {
+        Page data;
+        std::list<Key>::iterator lru;
+    };
+
+    struct File {
+        std::filesystem::path path;
+        uint64_t size;
+    };
+
+    const size_t pageSize;
+    mutable std::mutex mutex;
+    std::condition_variable pageLoaded;
+    std::vector<File> files;
+    std::unordered_map<std::string, FileId> fileIds;
+    std::unordered_map<Key, Entry, KeyHash> pages;
+    // Pages being read by some thread, others wait for them instead of reading them again
+    std::unordered_set<Key, KeyHash> loading;
+    // Most recently used first
+    std::list<Key> lru;
+    size_t residentBytes = 0;
+    size_t capacity;
+    Stats stats;
+    // Destroyed first, so running readahead finishes while the cache is still alive
+    TaskGroup readaheadTasks;
+
+    Page readPage(const File& file, uint64_t page) const {
+        uint64_t offset = page * pageSize;
+        size_t bytes = static_cast<size_t>(std::min<uint64_t>(pageSize, file.size - offset));
+        auto data = std::make_shared<std::vector<std::byte>>(bytes);
+        std::ifstream in(file.path, std::ios::binary);
+        if (!in.good()) {
+            std::cout << "File \"" << file.path << "\" couldn't be opened!";
+            checkFile(in);
+        }
+        in.seekg(offset);
+        in.read(reinterpret_cast<char*>(data->data()), bytes);
+        checkFile(in);
+        return data;
+    }
+
+    size_t evictLocked(size_t target) {
+        size_t released = 0;
+        while (residentBytes > target && !lru.empty()) {
+            auto entry = pages.find(lru.back());
+            size_t bytes = entry->second.data->size();
+            residentBytes -= bytes;
+            released += bytes;
+            pages.erase(entry);
+            lru.pop_back();
+        }
+        return released;
+    }
+
+    void insertLocked(Key key, Page data) {
+        residentBytes += data->size();
+        lru.push_front(key);
+        pages.emplace(key, Entry{ std::move(data), lru.begin() });
+        evictLocked(capacity);
+    }
+
+    // Reads the page on this thread unless it is resident or already being read
+    Page load(Key key, bool count) {
+        std::unique_lock lock(mutex);
+        while (true) {
+            if (auto entry = pages.find(key); entry != pages.end()) {
+                lru.splice(lru.begin(), lru, entry->second.lru);
+                if (count) stats.hits++;
+                return entry->second.data;
+            }
+            if (!loading.contains(key)) break;
+            pageLoaded.wait(lock);
+        }
+        if (count) stats.misses++;
+        loading.insert(key);
+        const File file = files[key.file];
+        lock.unlock();
+
+        Page data;
+        try {
+            data = readPage(file, key.page);
+        }
+        catch (...) {
+            lock.lock();
+            loading.erase(key);
+            pageLoaded.notify_all();
+            throw;
+        }
+
+        lock.lock();
+        loading.erase(key);
+        insertLocked(key, data);
+        pageLoaded.notify_all();
+        return data;
+    }
+
+public:
+    explicit PageCache(size_t capacity, size_t pageSize = defaultPageSize) :
+        pageSize(pageSize),
+        capacity(capacity) { }
+
+    PageCache(const PageCache&) = delete;
+    PageCache& operator=(const PageCache&) = delete;
+
+    // Ids stay valid for the lifetime of the cache, files are expected not to change while they are cached
+    FileId open(const std::filesystem::path& path) {
+        auto key = std::filesystem::absolute(path).string();
+        std::lock_guard lock(mutex);
+        if (auto id = fileIds.find(key); id != fileIds.end()) {
+            return id->second;
+        }
+        if (!std::filesystem::exists(path)) {
+            std::string msg = "File \"" + path.string() + "\" couldn't be opened!";
+            std::cout << msg << std::endl;
+            throw std::runtime_error{ msg };
+        }
+        auto id = static_cast<FileId>(files.size());
+        files.push_back({ path, std::filesystem::file_size(path) });
+        fileIds.emplace(std::move(key), id);
+        return id;
+    }
+
+    uint64_t fileSize(FileId file) const {
+        std::lock_guard lock(mutex);
+        return files[file].size;
+    }
+
+    size_t getPageSize() const {
+        return pageSize;
+    }
+
+    Page page(FileId file, uint64_t page) {
+        return load({ file, page }, true);
+    }
+
+    // Queues the pages overlapping [offset, offset + bytes) that aren't resident or being read
+    void prefetch(FileId file, uint64_t offset, uint64_t bytes) {
+        std::lock_guard lock(mutex);
+        uint64_t end = std::min(offset + bytes, files[file].size);
+        for (uint64_t page = offset / pageSize; page * pageSize < end; page++) {
+            Key key{ file, page };
+            if (pages.contains(key) || loading.contains(key)) continue;
+            stats.readahead++;
+            // Below the priority of every other task, readahead only uses idle workers
+            readaheadTasks.submit([this, key]() { load(key, false); }, -1);
+        }
+    }
+
+    // Copies [offset, offset + out.size()) of the file into `out`
+    void read(FileId file, uint64_t offset, std::span<std::byte> out) {
+        while (!out.empty()) {
+            auto data = page(file, offset / pageSize);
+            size_t begin = static_cast<size_t>(offset % pageSize);
+            if (begin >= data->size()) {
+                throw std::runtime_error{ "Read past the end of a cached file" };
+            }
+            size_t bytes = std::min(out.size(), data->size() - begin);
+            std::memcpy(out.data(), data->data() + begin, bytes);
+            out = out.subspan(bytes);
+            offset += bytes;
+        }
+    }
+
+    void setCapacity(size_t bytes) {
+        std::lock_guard lock(mutex);
+        capacity = bytes;
+        evictLocked(capacity);
+    }
+
+    size_t getCapacity() const {
+        std::lock_guard lock(mutex);
+        return capacity;
+    }
+
+    size_t memoryBytes() const {
+        std::lock_guard lock(mutex);
+        return residentBytes;
+    }
+
+    // Releases about `bytes` bytes of the least recently used pages, returns the released bytes
+    size_t evict(size_t bytes) {
+        std::lock_guard lock(mutex);
+        return evictLocked(residentBytes - std::min(bytes, residentBytes));
+    }
+
+    Stats getStats() const {
+        std::lock_guard lock(mutex);
+        return stats;
+    }
+};
+
+inline PageCache& pageCache() {
+    static PageCache cache(256 << 20);
+    return cache;
+}
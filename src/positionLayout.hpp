@@ -0,0 +1,365 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "utility.hpp"
+#include "mappedFile.hpp"
+#include "spatialIndex.hpp"
+
+// Neuron positions, the neuron-to-cluster mapping, cluster centroids and the scattered layout.
+// Computed once by PreprocessPositions and memory mapped by the viewer and PreprocessNetwork,
+// so all tools agree on the clusters.
+//
+// File layout: PositionLayoutHeader, positions[neuronCount], mapping[neuronCount], aggregated[clusterCount],
+// scattered[scatteredCount]
+
+using Position = std::array<float, 3>;
+
+struct PositionLayoutHeader {
+    static constexpr uint32_t expectedMagic = 0x534F5042; // "BPOS"
+    // Version 1 stored 16 bit cluster indices
+    static constexpr uint32_t expectedVersion = 2;
+
+    uint32_t magic = expectedMagic;
+    uint32_t version = expectedVersion;
+    uint32_t neuronCount = 0;
+    uint32_t clusterCount = 0;
+    uint32_t scatteredCount = 0;
+    uint32_t reserved = 0;
+};
+
+static_assert(sizeof(PositionLayoutHeader) == 6 * 4);
+static_assert(sizeof(Position) == 3 * sizeof(float));
+
+struct PositionLayoutView {
+    std::span<const Position> positions;
+    std::span<const uint32_t> mapping;
+    std::span<const Position> aggregated;
+    std::span<const Position> scattered;
+};
+
+struct PositionLayout {
+    std::vector<Position> positions;
+    std::vector<uint32_t> mapping;
+    std::vector<Position> aggregated;
+    std::vector<Position> scattered;
+
+    PositionLayoutView view() const {
+        return { positions, mapping, aggregated, scattered };
+    }
+};
+
+const std::filesystem::path positionLayoutPath = "positions-bin/layout";
+
+// Neurons closer than this to the first neuron of the current cluster belong to the same cluster
+constexpr double clusterDistance = 0.75;
+
+namespace positionLayoutDetail {
+
+    struct Point3 {
+        double x;
+        double y;
+        double z;
+
+        Point3(double x, double y, double z) {
+            this->x = x;
+            this->y = y;
+            this->z = z;
+        }
+
+        Point3(Position p) : Point3(p[0], p[1], p[2]) {}
+
+        void add(Point3 b) {
+            x += b.x;
+            y += b.y;
+            z += b.z;
+        }
+
+        double size() {
+            return sqrt(x * x + y * y + z * z);
+        }
+
+        void scale(double scale) {
+            x *= scale;
+            y *= scale;
+            z *= scale;
+        }
+
+        void normalize() {
+            double size = this->size();
+            x /= size;
+            y /= size;
+            z /= size;
+        }
+
+        Position toPosition() const {
+            return { static_cast<float>(x), static_cast<float>(y), static_cast<float>(z) };
+        }
+
+        static double dist(Point3 a, Point3 b) {
+            return sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y) + (a.z - b.z) * (a.z - b.z));
+        }
+
+        static Point3 cross(Point3 a, Point3 b) {
+            return Point3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+        }
+
+        static Point3 vector(Point3 a, Point3 b) {
+            Point3 p = Point3(a.x - b.x, a.y - b.y, a.z - b.z);
+            p.normalize();
+            return p;
+        }
+    };
+
+    struct PositionRow {
+        uint32_t id;
+        Position position;
+    };
+
+    // Parses "<id> <x> <y> <z> ..." rows, lines starting with '#' are comments
+    inline std::vector<PositionRow> parsePositions(const std::filesystem::path& path) {
+        std::ifstream file(path);
+        checkFile(file);
+
+        std::vector<PositionRow> rows;
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#') continue;
+
+            const char* it = line.data();
+            const char* end = line.data() + line.size();
+            auto skipSpaces = [&]() {
+                while (it != end && (*it == ' ' || *it == '\t')) it++;
+            };
+
+            PositionRow row{};
+            skipSpaces();
+            auto [idEnd, idError] = std::from_chars(it, end, row.id);
+            it = idEnd;
+            bool valid = idError == std::errc();
+            for (auto& coordinate : row.position) {
+                skipSpaces();
+                auto [coordinateEnd, error] = std::from_chars(it, end, coordinate);
+                it = coordinateEnd;
+                valid = valid && error == std::errc();
+            }
+            if (!valid || row.id == 0) {
+                throw std::runtime_error{ "Invalid row in positions file: " + line };
+            }
+            rows.push_back(row);
+        }
+        return rows;
+    }
+
+    // Generates random poisson disk patterns (equally spaced points)
+    // that are used to place the point clusters
+    inline std::vector<std::vector<std::array<double, 2>>> generatePatterns(std::mt19937& generator) {
+        const double collisionDistance = 0.6;
+        const int patternCount = 8;
+        const int patternSize = 10;
+        std::uniform_real_distribution<double> distribution(-1, 1);
+
+        std::vector<std::vector<std::array<double, 2>>> patterns;
+        for (int p = 0; p < patternCount; p++) {
+            std::vector<std::array<double, 2>> pattern = { { 0.0, 0.0 } };
+            int attempts = 0;
+            while (pattern.size() < patternSize) {
+                // Random placement can jam before the pattern is full, start over in that case
+                if (++attempts > 10'000) {
+                    pattern = { { 0.0, 0.0 } };
+                    attempts = 0;
+                }
+                double s = distribution(generator);
+                double t = distribution(generator);
+
+                bool hit = false;
+                for (auto [ps, pt] : pattern) {
+                    if (sqrt((s - ps) * (s - ps) + (t - pt) * (t - pt)) < collisionDistance) {
+                        hit = true;
+                        break;
+                    }
+                }
+                if (!hit) {
+                    pattern.push_back({ s, t });
+                }
+            }
+            patterns.push_back(std::move(pattern));
+        }
+        return patterns;
+    }
+
+    inline std::vector<Position> scatterClusters(std::span<const Position> aggregated) {
+        std::vector<SpatialIndex::Point> indexPoints;
+        indexPoints.reserve(aggregated.size());
+        for (auto& p : aggregated) {
+            indexPoints.push_back({ p[0], p[1], p[2] });
+        }
+        SpatialIndex index(std::move(indexPoints));
+
+        std::mt19937 generator(0);
+        auto patterns = generatePatterns(generator);
+        std::vector<int> chosenPatterns(aggregated.size());
+        for (auto& pattern : chosenPatterns) {
+            pattern = generator() % patterns.size();
+        }
+
+        const size_t patternSize = patterns[0].size();
+        std::vector<Position> scattered(aggregated.size() * patternSize);
+
+        parallelFor(aggregated.size(), [&](size_t i) {
+            Point3 center(aggregated[i]);
+
+            // First find 4 closest non-cluster points to given points
+            std::vector<Point3> closePoints(4, Point3(0.0, 0.0, 0.0));
+            auto nearest = index.kNearest({ center.x, center.y, center.z }, closePoints.size(), static_cast<uint32_t>(i));
+            for (size_t j = 0; j < nearest.size(); j++) {
+                closePoints[j] = Point3(aggregated[nearest[j]]);
+            }
+
+            double avgDistance = 0.0;
+            for (Point3& point : closePoints) {
+                avgDistance += Point3::dist(point, center);
+            }
+            avgDistance /= closePoints.size();
+
+            // Approximate derivatives using the 4 points by finding tuples whose vectors
+            // have the biggest angle between them
+            int possibilities[4][4] = { {0, 1, 2, 3}, {0, 2, 1, 3}, {0, 3, 1, 2}, {1, 2, 0, 3} };
+            int* best = possibilities[0];
+            double minDot = 1.0;
+            for (int* v : possibilities) {
+                Point3 first = Point3::vector(closePoints[v[0]], closePoints[v[1]]);
+                Point3 second = Point3::vector(closePoints[v[2]], closePoints[v[3]]);
+                double dot = first.x * second.x + first.y * second.y + first.z * second.z;
+                if (abs(dot) < minDot) {
+                    best = v;
+                    minDot = abs(dot);
+                }
+            }
+
+            Point3 first = Point3::vector(closePoints[best[0]], closePoints[best[1]]);
+            Point3 second = Point3::vector(closePoints[best[2]], closePoints[best[3]]);
+            Point3 normal = Point3::cross(first, second);
+            normal.normalize();
+
+            Point3 pa = Point3::cross(normal, first);
+            Point3 pb = Point3::cross(normal, pa);
+            pa.normalize();
+            pb.normalize();
+
+            // Generate the points using the calculated normal vector at that point + random patterns
+            double scale = std::clamp(avgDistance / 2.0, 1.0, 3.0);
+            auto& pattern = patterns[chosenPatterns[i]];
+            for (size_t j = 0; j < patternSize; j++) {
+                auto [s, t] = pattern[j];
+                Point3 point(center.x + scale * (s * pa.x + t * pb.x), center.y + scale * (s * pa.y + t * pb.y), center.z + scale * (s * pa.z + t * pb.z));
+                scattered[i * patternSize + j] = point.toPosition();
+            }
+        });
+        return scattered;
+    }
+}
+
+// Clusters consecutive neurons of the positions file and computes the scattered layout
+inline PositionLayout computePositionLayout(const std::filesystem::path& positionsFile) {
+    using positionLayoutDetail::Point3;
+
+    auto rows = positionLayoutDetail::parsePositions(positionsFile);
+
+    PositionLayout layout;
+    layout.positions.resize(rows.size());
+    layout.mapping.resize(rows.size());
+    if (rows.empty()) {
+        return layout;
+    }
+
+    int clusterIndex = 0;
+    Point3 current(rows[0].position);
+    Point3 average(0.0, 0.0, 0.0);
+    int pointCount = 0;
+
+    auto finishCluster = [&]() {
+        average.scale(1.0 / pointCount);
+        layout.aggregated.push_back(average.toPosition());
+    };
+
+    for (auto& row : rows) {
+        if (row.id > rows.size()) {
+            throw std::runtime_error{ "Neuron id " + std::to_string(row.id) + " is out of range." };
+        }
+
+        Point3 point(row.position);
+        if (Point3::dist(current, point) > clusterDistance) {
+            finishCluster();
+            clusterIndex++;
+
+            current = point;
+            average = Point3(0.0, 0.0, 0.0);
+            pointCount = 0;
+        }
+
+        average.add(point);
+        pointCount++;
+        layout.positions[row.id - 1] = row.position;
+        layout.mapping[row.id - 1] = static_cast<uint32_t>(clusterIndex);
+    }
+    finishCluster();
+
+    layout.scattered = positionLayoutDetail::scatterClusters(layout.aggregated);
+    return layout;
+}
+
+inline void writePositionLayout(const std::filesystem::path& path, const PositionLayout& layout) {
+    std::ofstream out(path, std::ios::binary);
+    checkFile(out);
+
+    PositionLayoutHeader header{
+        .neuronCount = static_cast<uint32_t>(layout.positions.size()),
+        .clusterCount = static_cast<uint32_t>(layout.aggregated.size()),
+        .scatteredCount = static_cast<uint32_t>(layout.scattered.size()),
+    };
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(layout.positions.data()), layout.positions.size() * sizeof(Position));
+    out.write(reinterpret_cast<const char*>(layout.mapping.data()), layout.mapping.size() * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char*>(layout.aggregated.data()), layout.aggregated.size() * sizeof(Position));
+    out.write(reinterpret_cast<const char*>(layout.scattered.data()), layout.scattered.size() * sizeof(Position));
+    checkFile(out);
+}
+
+// Memory mapped position layout written by writePositionLayout
+class MappedPositionLayout {
+    MappedFile file;
+    PositionLayoutView layoutView;
+
+public:
+    explicit MappedPositionLayout(const std::filesystem::path& path) :
+        file(path)
+    {
+        auto header = file.view<PositionLayoutHeader>(0, 1)[0];
+        if (header.magic != PositionLayoutHeader::expectedMagic || header.version != PositionLayoutHeader::expectedVersion) {
+            std::string msg = "File \"" + path.string() + "\" is not a supported position layout, rerun PreprocessPositions.";
+            std::cout << msg << std::endl;
+            throw std::runtime_error{ msg };
+        }
+
+        size_t offset = sizeof(PositionLayoutHeader);
+        layoutView.positions = file.view<Position>(offset, header.neuronCount);
+        offset += header.neuronCount * sizeof(Position);
+        layoutView.mapping = file.view<uint32_t>(offset, header.neuronCount);
+        offset += header.neuronCount * sizeof(uint32_t);
+        layoutView.aggregated = file.view<Position>(offset, header.clusterCount);
+        offset += header.clusterCount * sizeof(Position);
+        layoutView.scattered = file.view<Position>(offset, header.scatteredCount);
+    }
+
+    const PositionLayoutView& view() const { return layoutView; }
+};
@@ -9,83 +9,61 @@
 #include <unordered_map>
 
 #include "edge.hpp"
+#include "positionLayout.hpp"
+#include "datasetDescriptor.hpp"
 
-std::vector<uint16_t> loadMapping() {
-    vtkNew<vtkDelimitedTextReader> reader;
-    std::string path = (dataFolder / "positions/rank_0_positions.txt").string();
-    reader->SetFileName(path.data());
-    reader->DetectNumericColumnsOn();
-    reader->SetFieldDelimiterCharacters(" ");
-    reader->Update();
-
-    int point_index = -1;
-    vtkTable* table = reader->GetOutput();
-
-    std::vector<uint16_t> mapping(table->GetNumberOfRows());
-    //the first row is header
-
-    std::array<double, 3> prev_point{ INFINITY, INFINITY, INFINITY };
-    for (vtkIdType i = 1; i < table->GetNumberOfRows(); i++) {
-        if (table->GetValue(i, 0).ToString() == "#") continue;
-
-        std::array<double,3> point {
-             (table->GetValue(i, 1)).ToDouble(),
-             (table->GetValue(i, 2)).ToDouble(),
-             (table->GetValue(i, 3)).ToDouble()
-        };
-
-        if (manhattanDist(prev_point.data(), point.data()) > 0.5) {
-            prev_point = point;
-            point_index++;
-        }
-        mapping[(table->GetValue(i, 0)).ToInt() - 1] = point_index;
-    }
-    return mapping;
-}
-
-
-int main() {
+int main(int argc, char** argv) {
     setCurrentDirectory();
+    parseDataFolder(argc, argv);
+    auto dataset = updateDatasetDescriptor(dataFolder);
 
     confirmOperation("Write \"yes\" if you want to remove all files in network-bin and begin preprocessing.");
 
     std::filesystem::remove_all(dataFolder / "network-bin");
     std::filesystem::create_directory(dataFolder / "network-bin");
 
-    for (int i = 0; i < 100; i++) {
-        std::cout << i << "%\n";
+    // Same clusters as the viewer, written by PreprocessPositions
+    MappedPositionLayout layout(dataFolder / positionLayoutPath);
+    auto mapping = layout.view().mapping;
+
+    for (int i = 0; i < static_cast<int>(dataset.networkSnapshotCount); i++) {
+        std::cout << i * 100 / dataset.networkSnapshotCount << "%\n";
         vtkNew<vtkDelimitedTextReader> reader;
-        auto path = (dataFolder / "network/rank_0_step_").string() + std::to_string(i*10000) + "_in_network.txt";
+        auto step = std::to_string(dataset.snapshotStep(i));
+        auto path = (dataFolder / "network/rank_0_step_").string() + step + "_in_network.txt";
         reader->SetFileName(path.data());
         reader->DetectNumericColumnsOn();
         reader->SetFieldDelimiterCharacters(" \t");
         reader->Update();
 
-        auto mapping = loadMapping();
-
         vtkTable* table = reader->GetOutput();
 
-        std::unordered_map<uint32_t, int> edge_count;
+        std::unordered_map<uint64_t, uint32_t> edge_count;
 
-        auto output_path = (dataFolder / "network-bin/rank_0_step_").string() + std::to_string(i * 10000) + "_in_network";
-        std::ofstream out(output_path , std::ios::binary);
+        auto output_path = (dataFolder / "network-bin/rank_0_step_").string() + step + "_in_network";
         for (vtkIdType i = 0; i < table->GetNumberOfRows(); i++)
         {
             if (table->GetValue(i, 0).ToString() == "#") continue;
-            Edge edge{
-                .from = static_cast<uint16_t>(table->GetValue(i, 1).ToInt() - 1),
-                .to = static_cast<uint16_t>(table->GetValue(i, 3).ToInt() - 1),
-                .weight = static_cast<uint16_t>(table->GetValue(i, 4).ToInt())
-            };
-            edge_count[mapping[edge.from] << 16 | mapping[edge.to]]++;
+            // Only the cluster ids of the neurons are stored
+            auto fromId = table->GetValue(i, 1).ToTypeInt64();
+            auto toId = table->GetValue(i, 3).ToTypeInt64();
+            // Ids in the file start at 1
+            for (auto id : { fromId, toId }) {
+                if (id < 1 || static_cast<uint64_t>(id) > mapping.size()) {
+                    std::cout << "Neuron id " << id << " in row " << i + 1 << " of " << path
+                        << " is out of range of the " << mapping.size() << " neurons of the position layout" << std::endl;
+                    throw std::runtime_error("Invalid neuron id");
+                }
+            }
+            edge_count[static_cast<uint64_t>(mapping[fromId - 1]) << 32 | mapping[toId - 1]]++;
         }
 
-        std::vector<std::pair<uint32_t, int>> edges(edge_count.begin(), edge_count.end());
-        std::sort(edges.begin(), edges.end(), [](auto left, auto right) { return left.second > right.second; });
-
-        for (auto& [val, count] : edges) {
-            Edge new_edge{ val >> 16, static_cast<uint16_t>(val), count };
-            out.write(reinterpret_cast<const char*>(&new_edge), sizeof(new_edge));
+        std::vector<Edge> edges;
+        edges.reserve(edge_count.size());
+        for (auto& [val, count] : edge_count) {
+            edges.push_back({ static_cast<uint32_t>(val >> 32), static_cast<uint32_t>(val), count });
         }
+        std::sort(edges.begin(), edges.end(), [](auto& left, auto& right) { return left.weight > right.weight; });
+        writeEdges(output_path, edges);
     }
 }
\ No newline at end of file
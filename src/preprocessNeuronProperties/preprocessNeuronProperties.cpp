@@ -1,15 +1,26 @@
 #undef NDEBUG
+#include <algorithm>
 #include <array>
 #include <filesystem>
 #include <iostream>
 #include <fstream>
 #include <ranges>
+#include <chrono>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "vis/binaryReader.hpp"
 #include "utility.hpp"
 #include "neuronProperties.hpp"
+#include "neuronHistory.hpp"
+#include "datasetDescriptor.hpp"
+#include "positionLayout.hpp"
+#include "mappedFile.hpp"
 
-void preprocessProperties(std::filesystem::path dataFolder) {
+void preprocessProperties(std::filesystem::path dataFolder, const DatasetDescriptor& dataset) {
     confirmOperation("Write \"yes\" if you want to remove all files in monitors-bin and begin preprocessing.");
 
     using namespace std::chrono;
@@ -25,25 +36,27 @@ void preprocessProperties(std::filesystem::path dataFolder) {
     auto globalStart = steady_clock::now();
     auto start = globalStart;
 
-    constexpr int stepCount = 50'000;
+    const int neuronCount = static_cast<int>(dataset.neuronCount);
+    const int timestepCount = static_cast<int>(dataset.timestepCount);
     constexpr int openFiles = 500;
 
-    for (int inOuter = 0; inOuter < stepCount; inOuter += openFiles) {
+    for (int inOuter = 0; inOuter < neuronCount; inOuter += openFiles) {
         if (inOuter % 500 == 0) {
             auto end = steady_clock::now();
-            std::cout << inOuter * 100 / 50'000 << "% " << duration_cast<duration<double>>(end - start) << "\n";
+            std::cout << static_cast<int64_t>(inOuter) * 100 / neuronCount << "% " << duration_cast<duration<double>>(end - start) << "\n";
             start = end;
         }
 
-        std::array<std::ifstream, openFiles> inFiles;
-        for (int in = 0; in < openFiles; in++) {
+        const int fileCount = std::min(openFiles, neuronCount - inOuter);
+        std::vector<std::ifstream> inFiles(fileCount);
+        for (int in = 0; in < fileCount; in++) {
             auto path = inputPath + std::to_string(in + inOuter) + ".csv";
             inFiles[in].open(path);
         }
 
-        for (int out = 0; out < 10'000; out++) {
+        for (int out = 0; out < timestepCount; out++) {
             std::ofstream out_file(outputPath + std::to_string(out), std::ios::binary | std::ios::app | std::ios::ate);
-            for (int in = 0; in < openFiles; in++) {
+            for (int in = 0; in < fileCount; in++) {
                 auto neuron = NeuronProperties::parse(inFiles[in]);
                 out_file.write(reinterpret_cast<const char*>(&neuron), sizeof(neuron));
             }
@@ -86,34 +99,38 @@ std::string attributeToString(int attribute) {
     return "";
 }
 
-void preprocessTimestepProperties(std::filesystem::path dataFolder, int timestepCount) {
+void preprocessTimestepProperties(std::filesystem::path dataFolder, const DatasetDescriptor& dataset) {
     confirmOperation("Write \"yes\" if you want to remove all files in monitors-histogram and begin preprocessing.");
-    const int pointCount = 50000;
-    const int attributeCount = 12;
+    const int pointCount = static_cast<int>(dataset.neuronCount);
+    const int timestepCount = static_cast<int>(dataset.timestepCount);
+    const int attributeCount = NeuronProperties::attributeCount;
 
     std::ofstream outputFiles[attributeCount];
 
     std::filesystem::remove_all(dataFolder / "monitors-histogram");
     std::filesystem::create_directory(dataFolder / "monitors-histogram");
-    for (int i = 0; i < 12; i++) {
+    for (int i = 0; i < attributeCount; i++) {
         outputFiles[i].open((dataFolder / "monitors-histogram" / attributeToString(i)).string(), std::ios::binary);
         outputFiles[i] << "# mean sum max min\n";
     }
 
+    // Reused for every timestep
+    std::vector<NeuronProperties> neurons(pointCount);
+
     for (int i = 0; i < timestepCount; i++) {
         AttributeStack attributeData[attributeCount];
 
         auto path = (dataFolder / "monitors-bin/timestep").string() + std::to_string(i);
         BinaryReader<NeuronProperties> reader(path);
 
-        if (reader.count() < pointCount) {
+        if (reader.count() < static_cast<size_t>(pointCount)) {
             std::cout << "File:\"" << path << "\" is too small.\n";
             std::cout << sizeof(NeuronProperties) * pointCount << "bytes expected.\n";
         }
+        reader.read(std::span(neurons));
 
         // Iterate through every neuron and add up the values
-        for (int i = 0; i < pointCount; i++) {
-            NeuronProperties neuron = reader.read();
+        for (auto& neuron : neurons) {
             
             float value;
             for (int j = 0; j < attributeCount; j++) {
@@ -135,15 +152,186 @@ void preprocessTimestepProperties(std::filesystem::path dataFolder, int timestep
 }
 
 
-int main() {
-    const int timestepCount = 10000;
+// Transposes monitors-bin into neuron-major files, one per attribute
+void preprocessNeuronHistory(std::filesystem::path dataFolder, const DatasetDescriptor& dataset) {
+    confirmOperation("Write \"yes\" if you want to remove all files in monitors-neuron and begin preprocessing.");
+    const int pointCount = static_cast<int>(dataset.neuronCount);
+    const int timestepCount = static_cast<int>(dataset.timestepCount);
+    const int attributeCount = NeuronProperties::attributeCount;
+
+    using namespace std::chrono;
+    auto start = steady_clock::now();
+
+    std::filesystem::remove_all(dataFolder / neuronHistoryFolder);
+    std::filesystem::create_directory(dataFolder / neuronHistoryFolder);
+
+    std::ofstream outputFiles[attributeCount];
+    for (int i = 0; i < attributeCount; i++) {
+        outputFiles[i].open(dataFolder / neuronHistoryPath(i), std::ios::binary);
+        NeuronHistoryHeader header{
+            .neuronCount = static_cast<uint32_t>(pointCount),
+            .timestepCount = static_cast<uint32_t>(timestepCount),
+            .attribute = static_cast<uint32_t>(i)
+        };
+        outputFiles[i].write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    // Every timestep file is mapped once, the records of a block of neurons are copied out of all of them
+    auto inputPath = (dataFolder / "monitors-bin/timestep").string();
+    std::vector<MappedFile> inputs(timestepCount);
+    parallelFor(inputs.size(), [&](size_t timestep) {
+        inputs[timestep] = MappedFile(inputPath + std::to_string(timestep));
+    });
+
+    // A block of neurons is written as whole rows, as many neurons as fit into the budget of the transposed block
+    constexpr size_t blockBudget = size_t{ 256 } << 20;
+    const size_t rowBytes = static_cast<size_t>(attributeCount) * timestepCount * sizeof(float);
+    const int blockSize = static_cast<int>(std::clamp<size_t>(blockBudget / std::max<size_t>(rowBytes, 1), 1, std::max(pointCount, 1)));
+    std::vector<float> block(static_cast<size_t>(attributeCount) * blockSize * timestepCount);
+
+    for (int blockStart = 0; blockStart < pointCount; blockStart += blockSize) {
+        int neurons = std::min(blockSize, pointCount - blockStart);
+        std::cout << blockStart * 100 / pointCount << "% " << duration_cast<duration<double>>(steady_clock::now() - start) << "\n";
+
+        parallelChunks(timestepCount, workerCount(), [&](unsigned, size_t begin, size_t end) {
+            std::vector<NeuronProperties> properties(neurons);
+            for (size_t timestep = begin; timestep < end; timestep++) {
+                auto records = inputs[timestep].view<NeuronProperties>(static_cast<size_t>(blockStart) * sizeof(NeuronProperties), neurons);
+                std::ranges::copy(records, properties.begin());
+                fixupItems(std::span(properties));
+
+                for (int neuron = 0; neuron < neurons; neuron++) {
+                    for (int attribute = 0; attribute < attributeCount; attribute++) {
+                        block[(static_cast<size_t>(attribute) * blockSize + neuron) * timestepCount + timestep] = properties[neuron].projection(attribute);
+                    }
+                }
+            }
+        });
+
+        for (int attribute = 0; attribute < attributeCount; attribute++) {
+            auto* rows = block.data() + static_cast<size_t>(attribute) * blockSize * timestepCount;
+            outputFiles[attribute].write(reinterpret_cast<const char*>(rows), static_cast<size_t>(neurons) * timestepCount * sizeof(float));
+            checkFile(outputFiles[attribute]);
+        }
+    }
+    std::cout << "Duration: " << duration_cast<duration<double>>(steady_clock::now() - start) << "\n";
+}
+
+
+// Byte offsets of the starts of the lines of `bytes` up to line `lastLine`, followed by the end of that line
+std::vector<size_t> lineOffsets(std::span<const std::byte> bytes, size_t lastLine) {
+    std::vector<size_t> offsets = { 0 };
+    const char* begin = reinterpret_cast<const char*>(bytes.data());
+    const char* it = begin;
+    const char* end = begin + bytes.size();
+    while (offsets.size() <= lastLine + 1 && it != end) {
+        auto* newline = static_cast<const char*>(std::memchr(it, '\n', end - it));
+        it = newline ? newline + 1 : end;
+        offsets.push_back(it - begin);
+    }
+    return offsets;
+}
+
+// Replaces python_scripts/aggregate_edges.py process_monitors: writes the monitor row of the first neuron of every
+// position cluster at every network snapshot to monitors2/monitors_<step>.csv. Every monitor is mapped and scanned
+// for newlines once, the rows of all snapshots are extracted in the same pass, blocks of neurons are read in parallel.
+void sampleMonitors(std::filesystem::path dataFolder, const DatasetDescriptor& dataset, uint32_t snapshotCount) {
+    confirmOperation("Write \"yes\" if you want to remove all files in monitors2 and begin sampling.");
+    using namespace std::chrono;
+    auto start = steady_clock::now();
+
+    // Clusters of PreprocessPositions, so the samples match the clusters of the viewer and PreprocessNetwork
+    MappedPositionLayout layout(dataFolder / positionLayoutPath);
+    auto mapping = layout.view().mapping;
+    std::vector<uint32_t> chosen;
+    std::vector<bool> seen(layout.view().aggregated.size());
+    for (uint32_t neuron = 0; neuron < mapping.size(); neuron++) {
+        if (!seen[mapping[neuron]]) {
+            seen[mapping[neuron]] = true;
+            chosen.push_back(neuron);
+        }
+    }
+
+    std::vector<size_t> lines(snapshotCount);
+    for (uint32_t snapshot = 0; snapshot < snapshotCount; snapshot++) {
+        lines[snapshot] = dataset.snapshotStep(snapshot) / std::max(dataset.stepsPerTimestep, 1u);
+    }
+    const size_t lastLine = lines.empty() ? 0 : lines.back();
+
+    std::filesystem::remove_all(dataFolder / "monitors2");
+    std::filesystem::create_directory(dataFolder / "monitors2");
+    std::vector<std::ofstream> outputs(snapshotCount);
+    for (uint32_t snapshot = 0; snapshot < snapshotCount; snapshot++) {
+        outputs[snapshot].open(dataFolder / "monitors2" / ("monitors_" + std::to_string(dataset.snapshotStep(snapshot)) + ".csv"), std::ios::binary);
+        checkFile(outputs[snapshot]);
+    }
+
+    // Rows of a block, neuron-major, are written to every output in neuron order
+    constexpr size_t blockSize = 1024;
+    std::vector<std::string> rows(blockSize * snapshotCount);
+    // Short files are reported after the block, in neuron order, instead of from the worker threads
+    std::vector<std::string> errors(blockSize);
+    for (size_t blockStart = 0; blockStart < chosen.size(); blockStart += blockSize) {
+        size_t neurons = std::min(blockSize, chosen.size() - blockStart);
+        std::cout << blockStart * 100 / chosen.size() << "% " << duration_cast<duration<double>>(steady_clock::now() - start) << "\n";
+
+        parallelFor(neurons, [&](size_t i) {
+            auto path = dataFolder / "monitors" / ("0_" + std::to_string(chosen[blockStart + i]) + ".csv");
+            MappedFile file(path);
+            auto offsets = lineOffsets(file.bytes(), lastLine);
+            if (offsets.size() < lastLine + 2) {
+                errors[i] = "File \"" + path.string() + "\" has " + std::to_string(offsets.size() - 1) + " lines, "
+                    + std::to_string(lastLine + 1) + " are required.";
+                return;
+            }
+            auto* data = reinterpret_cast<const char*>(file.bytes().data());
+            for (uint32_t snapshot = 0; snapshot < snapshotCount; snapshot++) {
+                auto& row = rows[i * snapshotCount + snapshot];
+                row.assign(data + offsets[lines[snapshot]], data + offsets[lines[snapshot] + 1]);
+                if (row.empty() || row.back() != '\n') {
+                    row += '\n';
+                }
+            }
+        });
+        for (size_t i = 0; i < neurons; i++) {
+            if (!errors[i].empty()) {
+                std::cout << errors[i] << std::endl;
+                throw std::runtime_error{ errors[i] };
+            }
+        }
+
+        for (uint32_t snapshot = 0; snapshot < snapshotCount; snapshot++) {
+            for (size_t i = 0; i < neurons; i++) {
+                outputs[snapshot] << rows[i * snapshotCount + snapshot];
+            }
+            checkFile(outputs[snapshot]);
+        }
+    }
+    std::cout << chosen.size() << " neurons sampled at " << snapshotCount << " snapshots, duration: "
+        << duration_cast<duration<double>>(steady_clock::now() - start) << "\n";
+}
+
+
+int main(int argc, char** argv) {
     setCurrentDirectory();
-    const std::filesystem::path calciumFolder = "./data/viz-calcium";
+    parseDataFolder(argc, argv);
+    // "sample-monitors [snapshots]" samples the monitors for the network snapshots instead of preprocessing them
+    if (argc > 1 && std::string_view(argv[1]) == "sample-monitors") {
+        auto dataset = updateDatasetDescriptor(dataFolder);
+        uint32_t snapshots = argc > 2 ? static_cast<uint32_t>(std::stoul(argv[2])) : dataset.networkSnapshotCount;
+        sampleMonitors(dataFolder, dataset, snapshots);
+        return 0;
+    }
+
+    const std::filesystem::path calciumFolder = dataFolder;
     const std::filesystem::path stimulusFolder = "./data/viz-stimulus";
     const std::filesystem::path disableFolder = "./data/viz-disable";
-    //preprocessProperties(calciumFolder);
-    //preprocessProperties(stimulusFolder);
-    //preprocessProperties(disableFolder);
-    preprocessTimestepProperties(calciumFolder, 10000);
+    // Sizes come from the simulation output in the folder, see DatasetDescriptor
+    auto calciumDataset = updateDatasetDescriptor(calciumFolder);
+    //preprocessProperties(calciumFolder, calciumDataset);
+    //preprocessProperties(stimulusFolder, updateDatasetDescriptor(stimulusFolder));
+    //preprocessProperties(disableFolder, updateDatasetDescriptor(disableFolder));
+    preprocessTimestepProperties(calciumFolder, calciumDataset);
+    preprocessNeuronHistory(calciumFolder, calciumDataset);
 
 }
\ No newline at end of file
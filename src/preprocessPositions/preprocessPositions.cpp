@@ -0,0 +1,24 @@
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+#include "utility.hpp"
+#include "positionLayout.hpp"
+#include "datasetDescriptor.hpp"
+
+int main(int argc, char** argv) {
+    using namespace std::chrono;
+    setCurrentDirectory();
+    parseDataFolder(argc, argv);
+    updateDatasetDescriptor(dataFolder);
+
+    auto start = steady_clock::now();
+
+    auto layout = computePositionLayout(dataFolder / "positions/rank_0_positions.txt");
+    std::cout << layout.positions.size() << " neurons in " << layout.aggregated.size() << " clusters\n";
+
+    std::filesystem::create_directories((dataFolder / positionLayoutPath).parent_path());
+    writePositionLayout(dataFolder / positionLayoutPath, layout);
+
+    std::cout << "Duration: " << duration_cast<duration<double>>(steady_clock::now() - start) << "\n";
+}
@@ -0,0 +1,337 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <span>
+#include <vector>
+
+#include "utility.hpp"
+
+// Uniform grid over a set of 3D points.
+// Answers k-nearest and radius queries in time proportional to the number of visited cells
+// instead of the number of points. Cells are stored as a counting sort of point indices,
+// so one cell is a contiguous range in `order`.
+class SpatialIndex {
+public:
+    using Point = std::array<double, 3>;
+    static constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+    SpatialIndex() = default;
+
+    // cellSize <= 0 picks a cell size so that an average cell holds about `pointsPerCell` points
+    explicit SpatialIndex(std::vector<Point> points, double cellSize = 0, double pointsPerCell = 2.0) {
+        build(std::move(points), cellSize, pointsPerCell);
+    }
+
+    void build(std::vector<Point> newPoints, double cellSize = 0, double pointsPerCell = 2.0) {
+        points = std::move(newPoints);
+        order.clear();
+        cellStart.clear();
+        if (points.empty()) {
+            return;
+        }
+
+        computeBounds(cellSize, pointsPerCell);
+
+        size_t cellCount = static_cast<size_t>(dims[0]) * dims[1] * dims[2];
+        unsigned chunkCount = workerCount();
+        std::vector<uint32_t> cellOfPoint(points.size());
+        std::vector<std::vector<uint32_t>> chunkCounts(chunkCount);
+
+        // Parallel counting sort: every chunk counts its own points per cell...
+        parallelChunks(points.size(), chunkCount, [&](unsigned chunk, size_t begin, size_t end) {
+            auto& counts = chunkCounts[chunk];
+            counts.assign(cellCount, 0);
+            for (size_t i = begin; i < end; i++) {
+                uint32_t cell = cellIndex(cellOf(points[i]));
+                cellOfPoint[i] = cell;
+                counts[cell]++;
+            }
+        });
+
+        // ...offsets are prefix sums over (cell, chunk)...
+        cellStart.resize(cellCount + 1);
+        uint32_t offset = 0;
+        for (size_t cell = 0; cell < cellCount; cell++) {
+            cellStart[cell] = offset;
+            for (auto& counts : chunkCounts) {
+                if (counts.empty()) continue;
+                uint32_t count = counts[cell];
+                counts[cell] = offset;
+                offset += count;
+            }
+        }
+        cellStart[cellCount] = offset;
+
+        // ...and every chunk scatters its points to its own slots, which keeps the order stable.
+        order.resize(points.size());
+        parallelChunks(points.size(), chunkCount, [&](unsigned chunk, size_t begin, size_t end) {
+            auto& offsets = chunkCounts[chunk];
+            for (size_t i = begin; i < end; i++) {
+                order[offsets[cellOfPoint[i]]++] = static_cast<uint32_t>(i);
+            }
+        });
+    }
+
+    size_t size() const { return points.size(); }
+
+    bool empty() const { return points.empty(); }
+
+    const Point& point(uint32_t index) const { return points[index]; }
+
+    std::span<const Point> getPoints() const { return points; }
+
+    // Indices of the k closest points sorted by distance, `exclude` is skipped
+    std::vector<uint32_t> kNearest(Point p, size_t k, uint32_t exclude = none) const {
+        std::vector<uint32_t> result;
+        if (k == 0 || points.empty()) {
+            return result;
+        }
+
+        using Candidate = std::pair<double, uint32_t>;
+        std::priority_queue<Candidate> best; // max-heap on squared distance
+
+        Point clamped;
+        for (int i = 0; i < 3; i++) {
+            clamped[i] = std::clamp(p[i], boundsMin[i], boundsMax[i]);
+        }
+        double outsideDist = std::sqrt(dist2(p, clamped));
+        auto center = cellOf(clamped);
+        int maxRing = std::max({ dims[0], dims[1], dims[2] });
+
+        for (int ring = 0; ring <= maxRing; ring++) {
+            if (best.size() == k) {
+                // Every point in this ring is at least (ring - 1) cells away from the center cell
+                double bound = std::max(0.0, (ring - 1) * cellSize - outsideDist);
+                if (bound * bound > best.top().first) {
+                    break;
+                }
+            }
+            forEachCellInRing(center, ring, [&](uint32_t cell) {
+                for (uint32_t j = cellStart[cell]; j < cellStart[cell + 1]; j++) {
+                    uint32_t index = order[j];
+                    if (index == exclude) continue;
+                    double d = dist2(p, points[index]);
+                    if (best.size() < k) {
+                        best.emplace(d, index);
+                    }
+                    else if (d < best.top().first) {
+                        best.pop();
+                        best.emplace(d, index);
+                    }
+                }
+            });
+        }
+
+        result.resize(best.size());
+        for (size_t i = result.size(); i-- > 0;) {
+            result[i] = best.top().second;
+            best.pop();
+        }
+        return result;
+    }
+
+    // Indices of all points within `radius` from `p`, in no particular order
+    std::vector<uint32_t> withinRadius(Point p, double radius) const {
+        std::vector<uint32_t> result;
+        double radius2 = radius * radius;
+        forEachCellInBox({ p[0] - radius, p[1] - radius, p[2] - radius }, { p[0] + radius, p[1] + radius, p[2] + radius },
+            [&](uint32_t cell) {
+                for (uint32_t j = cellStart[cell]; j < cellStart[cell + 1]; j++) {
+                    uint32_t index = order[j];
+                    if (dist2(p, points[index]) <= radius2) {
+                        result.push_back(index);
+                    }
+                }
+            });
+        return result;
+    }
+
+    // Indices of all points inside the axis aligned box, in no particular order
+    std::vector<uint32_t> withinBox(Point min, Point max) const {
+        std::vector<uint32_t> result;
+        forEachCellInBox(min, max, [&](uint32_t cell) {
+            for (uint32_t j = cellStart[cell]; j < cellStart[cell + 1]; j++) {
+                uint32_t index = order[j];
+                auto& p = points[index];
+                if (min[0] <= p[0] && p[0] <= max[0] && min[1] <= p[1] && p[1] <= max[1] && min[2] <= p[2] && p[2] <= max[2]) {
+                    result.push_back(index);
+                }
+            }
+        });
+        return result;
+    }
+
+    // Index of the point closest to `from` among points within `radius` of the segment from-to,
+    // `none` if there is no such point. Used for picking along a camera ray.
+    uint32_t firstAlongSegment(Point from, Point to, double radius) const {
+        if (points.empty() || radius <= 0) {
+            return none;
+        }
+
+        Point direction{ to[0] - from[0], to[1] - from[1], to[2] - from[2] };
+        double length = std::sqrt(dist2(from, to));
+        if (length == 0) {
+            return none;
+        }
+        for (auto& d : direction) {
+            d /= length;
+        }
+
+        // Clip the segment to the bounds grown by the radius
+        double tMin = 0;
+        double tMax = length;
+        for (int i = 0; i < 3; i++) {
+            double lo = boundsMin[i] - radius;
+            double hi = boundsMax[i] + radius;
+            if (std::abs(direction[i]) < 1e-12) {
+                if (from[i] < lo || from[i] > hi) {
+                    return none;
+                }
+                continue;
+            }
+            double t0 = (lo - from[i]) / direction[i];
+            double t1 = (hi - from[i]) / direction[i];
+            tMin = std::max(tMin, std::min(t0, t1));
+            tMax = std::min(tMax, std::max(t0, t1));
+        }
+        if (tMin > tMax) {
+            return none;
+        }
+
+        // Points within `radius` of the segment part around a sample are within sampleRadius of the sample
+        double step = radius;
+        double sampleRadius = std::sqrt(radius * radius + step * step / 4);
+
+        uint32_t best = none;
+        double bestT = std::numeric_limits<double>::infinity();
+        for (double t = tMin; t <= tMax + step; t += step) {
+            if (t - step / 2 > bestT) {
+                break;
+            }
+            Point sample{ from[0] + t * direction[0], from[1] + t * direction[1], from[2] + t * direction[2] };
+            for (uint32_t index : withinRadius(sample, sampleRadius)) {
+                auto& p = points[index];
+                Point offset{ p[0] - from[0], p[1] - from[1], p[2] - from[2] };
+                double along = offset[0] * direction[0] + offset[1] * direction[1] + offset[2] * direction[2];
+                double perpendicular2 = dist2(p, from) - along * along;
+                if (along >= 0 && along <= length && perpendicular2 <= radius * radius && along < bestT) {
+                    bestT = along;
+                    best = index;
+                }
+            }
+        }
+        return best;
+    }
+
+    size_t memoryBytes() const {
+        return points.capacity() * sizeof(Point) + (order.capacity() + cellStart.capacity()) * sizeof(uint32_t);
+    }
+
+    static double dist2(const Point& a, const Point& b) {
+        double dx = a[0] - b[0];
+        double dy = a[1] - b[1];
+        double dz = a[2] - b[2];
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+private:
+    std::vector<Point> points;
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> cellStart;
+
+    Point boundsMin{};
+    Point boundsMax{};
+    double cellSize = 1;
+    std::array<int, 3> dims{ 1, 1, 1 };
+
+    void computeBounds(double requestedCellSize, double pointsPerCell) {
+        boundsMin = points[0];
+        boundsMax = points[0];
+        for (auto& p : points) {
+            for (int i = 0; i < 3; i++) {
+                boundsMin[i] = std::min(boundsMin[i], p[i]);
+                boundsMax[i] = std::max(boundsMax[i], p[i]);
+            }
+        }
+
+        double volume = 1;
+        for (int i = 0; i < 3; i++) {
+            volume *= std::max(boundsMax[i] - boundsMin[i], 1e-6);
+        }
+        cellSize = requestedCellSize > 0 ? requestedCellSize : std::cbrt(volume * pointsPerCell / points.size());
+        cellSize = std::max(cellSize, 1e-6);
+
+        // Keep the cell count proportional to the point count even for degenerate bounds,
+        // cells are grown instead of clamped so that the ring bound in kNearest stays valid
+        constexpr int maxDim = 1024;
+        double maxExtent = std::max({ boundsMax[0] - boundsMin[0], boundsMax[1] - boundsMin[1], boundsMax[2] - boundsMin[2] });
+        cellSize = std::max(cellSize, maxExtent / (maxDim - 1));
+        while (true) {
+            for (int i = 0; i < 3; i++) {
+                dims[i] = static_cast<int>((boundsMax[i] - boundsMin[i]) / cellSize) + 1;
+            }
+            if (static_cast<double>(dims[0]) * dims[1] * dims[2] <= 8.0 * points.size() + 64) {
+                break;
+            }
+            cellSize *= 1.25;
+        }
+    }
+
+    std::array<int, 3> cellOf(const Point& p) const {
+        std::array<int, 3> cell;
+        for (int i = 0; i < 3; i++) {
+            cell[i] = std::clamp(static_cast<int>(std::floor((p[i] - boundsMin[i]) / cellSize)), 0, dims[i] - 1);
+        }
+        return cell;
+    }
+
+    uint32_t cellIndex(std::array<int, 3> cell) const {
+        return static_cast<uint32_t>((cell[2] * dims[1] + cell[1]) * dims[0] + cell[0]);
+    }
+
+    template<typename F>
+    void forEachCellInBox(const Point& min, const Point& max, F&& f) const {
+        if (points.empty()) {
+            return;
+        }
+        for (int i = 0; i < 3; i++) {
+            if (max[i] < boundsMin[i] || min[i] > boundsMax[i]) {
+                return;
+            }
+        }
+        auto lo = cellOf(min);
+        auto hi = cellOf(max);
+        for (int z = lo[2]; z <= hi[2]; z++) {
+            for (int y = lo[1]; y <= hi[1]; y++) {
+                for (int x = lo[0]; x <= hi[0]; x++) {
+                    f(cellIndex({ x, y, z }));
+                }
+            }
+        }
+    }
+
+    // Visits cells whose Chebyshev distance from `center` is exactly `ring`
+    template<typename F>
+    void forEachCellInRing(std::array<int, 3> center, int ring, F&& f) const {
+        for (int dz = -ring; dz <= ring; dz++) {
+            int z = center[2] + dz;
+            if (z < 0 || z >= dims[2]) continue;
+            for (int dy = -ring; dy <= ring; dy++) {
+                int y = center[1] + dy;
+                if (y < 0 || y >= dims[1]) continue;
+                bool onShell = std::abs(dz) == ring || std::abs(dy) == ring;
+                int step = onShell || ring == 0 ? 1 : 2 * ring;
+                for (int dx = -ring; dx <= ring; dx += step) {
+                    int x = center[0] + dx;
+                    if (x < 0 || x >= dims[0]) continue;
+                    f(cellIndex({ x, y, z }));
+                }
+            }
+        }
+    }
+};
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "utility.hpp"
+#include "edge.hpp"
+#include "neuronProperties.hpp"
+#include "datasetDescriptor.hpp"
+
+// Deterministic synthetic datasets in the formats of the simulation output and of the preprocessed files,
+// so tools can be exercised without the real data. Every value is a pure function of its coordinates,
+// files can therefore be written in any order and in parallel.
+namespace synthetic {
+
+    struct DatasetSize {
+        uint32_t neuronCount = 50'000;
+        uint32_t timestepCount = 10'000;
+        // Network snapshots are stored every 10000 simulation steps
+        uint32_t networkSnapshots = 100;
+        uint32_t edgesPerNeuron = 20;
+        uint32_t neuronsPerCluster = 5;
+        // Edge length of the box the clusters are spread over
+        double extent = 200;
+        int binCount = 64;
+    };
+
+    // Steps per timestep and per snapshot are the defaults, the writers below use the same
+    inline DatasetDescriptor descriptor(const DatasetSize& size) {
+        DatasetDescriptor result;
+        result.neuronCount = size.neuronCount;
+        result.timestepCount = size.timestepCount;
+        result.networkSnapshotCount = size.networkSnapshots;
+        return result;
+    }
+
+    // Uniform value in [0, 1) derived from the arguments
+    inline double noise(uint64_t a, uint64_t b = 0, uint64_t c = 0) {
+        uint64_t x = a * 0x9E3779B97F4A7C15ull ^ (b + 0x632BE59BD9B4E019ull) * 0xC2B2AE3D27D4EB4Full ^ (c + 0x165667B19E3779F9ull);
+        x ^= x >> 33;
+        x *= 0xFF51AFD7ED558CCDull;
+        x ^= x >> 33;
+        x *= 0xC4CEB9FE1A85EC53ull;
+        x ^= x >> 33;
+        return static_cast<double>(x >> 11) * 0x1.0p-53;
+    }
+
+    // Neurons of one cluster lie within 0.3 of the cluster center, clusters are spread over an extent^3 box
+    inline std::array<float, 3> position(const DatasetSize& size, uint32_t neuron) {
+        uint32_t cluster = neuron / size.neuronsPerCluster;
+        std::array<float, 3> result;
+        for (int axis = 0; axis < 3; axis++) {
+            double center = size.extent * noise(cluster, axis, 1);
+            double offset = 0.3 * (2 * noise(neuron, axis, 2) - 1);
+            result[axis] = static_cast<float>(center + offset);
+        }
+        return result;
+    }
+
+    // Properties of a neuron at a timestep, `fired` is stored as a character like in the simulation output
+    inline NeuronProperties neuronProperties(uint32_t neuron, uint32_t timestep) {
+        double phase = noise(neuron, 0, 3) * 6.283;
+        double wave = 0.5 + 0.4 * std::sin(timestep * 0.01 + phase);
+        auto jitter = [&](int attribute) { return noise(neuron, timestep, attribute) - 0.5; };
+
+        NeuronProperties result{};
+        bool fired = noise(neuron, timestep, 4) < 0.1 * wave;
+        result.fired = static_cast<uint8_t>('0' + fired);
+        result.firedFraction = static_cast<float>(0.1 * wave);
+        result.electricActivity = static_cast<float>(wave + 0.1 * jitter(5));
+        result.secondaryVariable = static_cast<float>(0.2 * wave + 0.05 * jitter(6));
+        result.calcium = static_cast<float>(0.7 * wave + 0.02 * jitter(7));
+        result.targetCalcium = 0.7f;
+        result.synapticInput = static_cast<float>(20 * wave + 2 * jitter(8));
+        result.backgroundActivity = static_cast<float>(5 + jitter(9));
+        result.grownAxons = static_cast<float>(timestep * 0.002 * (1 + noise(neuron, 0, 10)));
+        result.connectedAxons = static_cast<uint32_t>(result.grownAxons);
+        result.grownDendrites = static_cast<float>(timestep * 0.002 * (1 + noise(neuron, 0, 11)));
+        result.connectedDendrites = static_cast<uint32_t>(result.grownDendrites);
+        return result;
+    }
+
+    // Source neuron of the `index`-th incoming edge of `target`, mostly close to the target
+    inline uint32_t edgeSource(const DatasetSize& size, uint32_t target, uint32_t index, uint32_t snapshot) {
+        double spread = noise(target, index, 12) < 0.8 ? 200 : size.neuronCount;
+        auto offset = static_cast<uint32_t>(spread * noise(target, index + snapshot, 13));
+        return (target + 1 + offset) % size.neuronCount;
+    }
+
+    // positions/rank_0_positions.txt
+    inline void writePositions(const std::filesystem::path& folder, const DatasetSize& size) {
+        std::filesystem::create_directories(folder / "positions");
+        std::ofstream out(folder / "positions/rank_0_positions.txt");
+        checkFile(out);
+        out << "# Synthetic dataset\n# <local id> <pos x> <pos y> <pos z> <area> <type>\n";
+        for (uint32_t i = 0; i < size.neuronCount; i++) {
+            auto p = position(size, i);
+            out << i + 1 << ' ' << p[0] << ' ' << p[1] << ' ' << p[2] << " area_" << i / size.neuronsPerCluster % 48 << " ex\n";
+        }
+        checkFile(out);
+    }
+
+    // monitors/0_<neuron>.csv, one line per timestep
+    inline void writeMonitors(const std::filesystem::path& folder, const DatasetSize& size) {
+        std::filesystem::create_directories(folder / "monitors");
+        parallelFor(size.neuronCount, [&](size_t neuron) {
+            std::ofstream out(folder / "monitors" / ("0_" + std::to_string(neuron) + ".csv"));
+            checkFile(out);
+            for (uint32_t t = 0; t < size.timestepCount; t++) {
+                auto p = neuronProperties(static_cast<uint32_t>(neuron), t);
+                out << t * 100 << ';' << p.fired << ';' << p.firedFraction << ';' << p.electricActivity << ';' << p.secondaryVariable << ';'
+                    << p.calcium << ';' << p.targetCalcium << ';' << p.synapticInput << ';' << p.backgroundActivity << ';'
+                    << p.grownAxons << ';' << p.connectedAxons << ';' << p.grownDendrites << ';' << p.connectedDendrites << '\n';
+            }
+            checkFile(out);
+        });
+    }
+
+    // monitors-bin/timestep<t>, as written by PreprocessNeuronProperties
+    inline void writeMonitorsBin(const std::filesystem::path& folder, const DatasetSize& size) {
+        std::filesystem::create_directories(folder / "monitors-bin");
+        parallelFor(size.timestepCount, [&](size_t t) {
+            std::vector<NeuronProperties> neurons(size.neuronCount);
+            for (uint32_t i = 0; i < size.neuronCount; i++) {
+                neurons[i] = neuronProperties(i, static_cast<uint32_t>(t));
+            }
+            std::ofstream out(folder / "monitors-bin" / ("timestep" + std::to_string(t)), std::ios::binary);
+            checkFile(out);
+            out.write(reinterpret_cast<const char*>(neurons.data()), neurons.size() * sizeof(NeuronProperties));
+            checkFile(out);
+        });
+    }
+
+    // network/rank_0_step_<step>_in_network.txt
+    inline void writeNetwork(const std::filesystem::path& folder, const DatasetSize& size) {
+        std::filesystem::create_directories(folder / "network");
+        parallelFor(size.networkSnapshots, [&](size_t snapshot) {
+            auto step = std::to_string(snapshot * 10000);
+            std::ofstream out(folder / "network" / ("rank_0_step_" + step + "_in_network.txt"));
+            checkFile(out);
+            out << "# Total number synapses: " << size.neuronCount * size.edgesPerNeuron << "\n";
+            out << "# <target rank> <target neuron id> <source rank> <source neuron id> <weight>\n";
+            for (uint32_t target = 0; target < size.neuronCount; target++) {
+                for (uint32_t i = 0; i < size.edgesPerNeuron; i++) {
+                    uint32_t source = edgeSource(size, target, i, static_cast<uint32_t>(snapshot));
+                    out << "0 " << target + 1 << " 0 " << source + 1 << ' ' << 1 + static_cast<int>(3 * noise(target, i, 14)) << '\n';
+                }
+            }
+            checkFile(out);
+        });
+    }
+
+    // network-bin/rank_0_step_<step>_in_network, cluster to cluster edges sorted by count like PreprocessNetwork writes them
+    inline void writeNetworkBin(const std::filesystem::path& folder, const DatasetSize& size) {
+        std::filesystem::create_directories(folder / "network-bin");
+        uint32_t clusterCount = (size.neuronCount + size.neuronsPerCluster - 1) / size.neuronsPerCluster;
+        size_t edgeCount = static_cast<size_t>(size.neuronCount) * size.edgesPerNeuron / 4;
+        parallelFor(size.networkSnapshots, [&](size_t snapshot) {
+            std::vector<Edge> edges(edgeCount);
+            for (size_t i = 0; i < edgeCount; i++) {
+                edges[i] = Edge{
+                    .from = static_cast<uint32_t>(clusterCount * noise(i, snapshot, 15)),
+                    .to = static_cast<uint32_t>(clusterCount * noise(i, snapshot, 16)),
+                    // Descending counts, a few heavy edges and many light ones
+                    .weight = static_cast<uint32_t>(1 + 200 * std::pow(1 - static_cast<double>(i) / edgeCount, 8)),
+                };
+            }
+            writeEdges(folder / "network-bin" / ("rank_0_step_" + std::to_string(snapshot * 10000) + "_in_network"), edges);
+        });
+    }
+
+    // monitors-hist-real/<attribute> with `binCount` counts per timestep and monitors-histogram/<attribute>
+    // with "mean sum max min" per timestep, `names` are the file names of the attributes
+    inline void writeHistograms(const std::filesystem::path& folder, const DatasetSize& size, const std::vector<std::string>& names) {
+        std::filesystem::create_directories(folder / "monitors-hist-real");
+        std::filesystem::create_directories(folder / "monitors-histogram");
+        parallelFor(names.size(), [&](size_t attribute) {
+            std::ofstream histogram(folder / "monitors-hist-real" / names[attribute]);
+            std::ofstream summary(folder / "monitors-histogram" / names[attribute]);
+            checkFile(histogram);
+            checkFile(summary);
+            int binCount = attribute == 0 ? 2 : size.binCount;
+            for (uint32_t t = 0; t < size.timestepCount; t++) {
+                double center = binCount * (0.5 + 0.4 * std::sin(t * 0.01 + attribute));
+                for (int bin = 0; bin < binCount; bin++) {
+                    double distance = (bin - center) / (binCount / 8.0);
+                    histogram << static_cast<int>(size.neuronCount / 8.0 * std::exp(-distance * distance)) << (bin + 1 < binCount ? ' ' : '\n');
+                }
+                double mean = center / binCount;
+                summary << mean << ' ' << mean * size.neuronCount << ' ' << mean + 0.3 << ' ' << mean - 0.3 << '\n';
+            }
+            checkFile(histogram);
+            checkFile(summary);
+        });
+    }
+}
@@ -1,8 +1,35 @@
 #pragma once
+#include <algorithm>
 #include <filesystem>
 #include <iostream>
+#include <string_view>
+#include <vector>
 
-const std::filesystem::path dataFolder = "./data/viz-calcium";
+// parallelChunks and parallelFor run on the shared worker pool
+#include "workerPool.hpp"
+
+// Root of the dataset relative to the repository, tools working on other data (e.g. the benchmarks) can redirect it
+inline std::filesystem::path dataFolder = "./data/viz-calcium";
+
+// Sets dataFolder from a "--data <folder>" option and removes the option from the arguments, so the remaining ones
+// are parsed as before. Has to run before dataset() is read for the first time.
+inline void parseDataFolder(int& argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (std::string_view(argv[i]) != "--data") {
+            continue;
+        }
+        if (i + 1 >= argc) {
+            const char* msg = "Missing value of --data";
+            std::cout << msg << std::endl;
+            throw std::runtime_error{ msg };
+        }
+        dataFolder = argv[i + 1];
+        // argv[argc] is a null pointer and moves along
+        std::copy(argv + i + 2, argv + argc + 1, argv + i);
+        argc -= 2;
+        i--;
+    }
+}
 
 inline void setCurrentDirectory() {
     std::filesystem::path path = std::filesystem::current_path();
@@ -29,7 +56,7 @@ inline void confirmOperation(const char* msg){
     exit(1);
 }
 
-inline void checkFile(std::istream& stream) {
+inline void checkFile(std::ios& stream) {
     if (!stream.good()) {
         std::string_view msg;
         if (stream.eof()) {
@@ -55,4 +82,4 @@ inline double manhattanDist(double* x, double* y) {
 
 inline double map_to_unit_range(double lower_bound, double upper_bound, double value) {
     return (value - lower_bound) / (upper_bound - lower_bound);
-}
\ No newline at end of file
+}
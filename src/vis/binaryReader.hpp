@@ -4,8 +4,20 @@
 #include <filesystem>
 #include <fstream>
 #include <cassert>
+#include <span>
 
 #include "utility.hpp"
+#include "pageCache.hpp"
+
+// Neuron properties store `fired` as a character like the simulation output
+template <typename T>
+void fixupItems(std::span<T> items) {
+    if constexpr (std::same_as<T, struct NeuronProperties>) {
+        for (auto& t : items) {
+            t.fired -= '0';
+        }
+    }
+}
 
 template <typename T>
 class BinaryReader {
@@ -30,12 +42,17 @@ public:
         T t;
         file.read(reinterpret_cast<char*>(&t), sizeof(T));
         checkFile(file);
-		if constexpr (std::same_as<T, struct NeuronProperties>) {
-            t.fired -= '0';
-        }
+        fixupItems(std::span(&t, 1));
         return t;
     }
 
+    // Reads items.size() items at once and increments position
+    void read(std::span<T> items) {
+        file.read(reinterpret_cast<char*>(items.data()), items.size_bytes());
+        checkFile(file);
+        fixupItems(items);
+    }
+
     // Return number of items stored in the file
     size_t count() { return itemCount; }
 
@@ -54,3 +71,66 @@ public:
         checkFile(file);
     }
 };
+
+// Same interface as BinaryReader, reads through the page cache and queues the next `readahead` bytes after every read
+template <typename T>
+class PagedReader {
+    PageCache& cache;
+    PageCache::FileId file;
+    size_t itemCount;
+    size_t pos = 0;
+    uint64_t readahead;
+    // End of the queued readahead, it is only extended once a page was consumed
+    uint64_t prefetchedEnd = 0;
+
+public:
+    PagedReader(const std::filesystem::path& path, uint64_t readahead = 4 * PageCache::defaultPageSize, PageCache& cache = pageCache()) :
+        cache(cache),
+        file(cache.open(path)),
+        readahead(readahead)
+    {
+        auto byteSize = cache.fileSize(file);
+        assert(byteSize % sizeof(T) == 0);
+        itemCount = byteSize / sizeof(T);
+    }
+
+    // Reads item and increments position
+    T read() {
+        T t;
+        read(std::span(&t, 1));
+        return t;
+    }
+
+    // Reads items.size() items at once and increments position
+    void read(std::span<T> items) {
+        if (pos + items.size() > itemCount) {
+            std::cout << "End of file was reached!\n";
+            throw std::runtime_error{ "End of file was reached!" };
+        }
+        uint64_t offset = pos * sizeof(T);
+        // Pages after the first one of a large read are read by idle workers in parallel
+        if (items.size_bytes() > cache.getPageSize()) {
+            cache.prefetch(file, offset + cache.getPageSize(), items.size_bytes() - cache.getPageSize());
+        }
+        cache.read(file, offset, std::as_writable_bytes(items));
+        pos += items.size();
+        fixupItems(items);
+        uint64_t end = offset + items.size_bytes();
+        if (readahead > 0 && end + readahead >= prefetchedEnd + cache.getPageSize()) {
+            cache.prefetch(file, end, readahead);
+            prefetchedEnd = end + readahead;
+        }
+    }
+
+    // Return number of items stored in the file
+    size_t count() { return itemCount; }
+
+    // Get position of the current item
+    size_t getPos() { return pos; }
+
+    // Set position of the current item
+    void setPos(size_t pos) {
+        assert(pos < itemCount);
+        this->pos = pos;
+    }
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <vtkActor.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPointGaussianMapper.h>
+#include <vtkPolyData.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderer.h>
+#include <vtkTextActor.h>
+#include <vtkTextProperty.h>
+
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "visUtility.hpp"
+#include "loaders.hpp"
+#include "workerPool.hpp"
+#include "datasetDescriptor.hpp"
+
+// Datasets compared with the one in dataFolder, e.g. viz-stimulus and viz-disable next to viz-calcium
+struct ComparisonOptions {
+    std::vector<std::filesystem::path> folders;
+    // Colors the difference of dataFolder and the first folder instead of showing the datasets side by side
+    bool difference = false;
+
+    bool enabled() const { return !folders.empty(); }
+    bool sideBySide() const { return enabled() && !difference; }
+};
+
+// Viewports of the compared datasets next to the primary one. They show the same positions with colors of the
+// same attribute and value range, and share the camera of the primary renderer, so interaction moves all of them.
+class ComparisonViews {
+    struct View {
+        std::filesystem::path folder;
+        vtkNew<vtkRenderer> renderer;
+        vtkNew<vtkPolyData> polyData;
+        vtkNew<vtkPointGaussianMapper> mapper;
+        vtkNew<vtkActor> actor;
+        vtkNew<vtkTextActor> label;
+        vtkSmartPointer<vtkUnsignedCharArray> colors;
+        std::future<vtkSmartPointer<vtkUnsignedCharArray>> pending;
+    };
+
+    std::vector<std::unique_ptr<View>> views;
+    vtkNew<vtkTextActor> primaryLabel;
+    TaskGroup tasks;
+
+    static void initLabel(vtkTextActor& label, const std::string& text) {
+        label.SetInput(text.c_str());
+        label.SetDisplayPosition(10, 10);
+        label.GetTextProperty()->SetFontSize(16);
+        label.GetTextProperty()->SetColor(namedColors->GetColor3d("Black").GetData());
+    }
+
+public:
+    ComparisonOptions options;
+
+    // The compared datasets have to be preprocessed with the same neurons as the primary one
+    static void checkDataset(const std::filesystem::path& folder) {
+        auto descriptor = std::filesystem::exists(folder / datasetDescriptorPath) ? readDatasetDescriptor(folder) : discoverDataset(folder);
+        if (descriptor.neuronCount != dataset().neuronCount || descriptor.timestepCount < dataset().timestepCount) {
+            std::cout << "Dataset " << folder << " has " << descriptor.neuronCount << " neurons and " << descriptor.timestepCount
+                << " timesteps, " << dataset().neuronCount << " neurons and " << dataset().timestepCount << " timesteps are required." << std::endl;
+            throw std::runtime_error("Incompatible dataset");
+        }
+    }
+
+    // Splits the window into one viewport per dataset, `splatShaderCode` is the shader of the primary points
+    void init(vtkRenderer& primary, vtkRenderWindow& window, const char* splatShaderCode) {
+        for (auto& folder : options.folders) {
+            checkDataset(folder);
+        }
+        if (options.difference) {
+            auto name = dataFolder.filename().string() + " - " + options.folders[0].filename().string();
+            initLabel(primaryLabel, name);
+            primary.AddViewProp(primaryLabel);
+        }
+        if (!options.sideBySide()) {
+            return;
+        }
+
+        size_t viewportCount = options.folders.size() + 1;
+        primary.SetViewport(0, 0, 1.0 / viewportCount, 1);
+        initLabel(primaryLabel, dataFolder.filename().string());
+        primary.AddViewProp(primaryLabel);
+
+        for (size_t i = 0; i < options.folders.size(); i++) {
+            auto& view = *views.emplace_back(std::make_unique<View>());
+            view.folder = options.folders[i];
+
+            view.mapper->SetInputData(view.polyData);
+            view.mapper->EmissiveOff();
+            view.mapper->SetColorModeToDirectScalars();
+            view.mapper->SetSplatShaderCode(splatShaderCode);
+            view.actor->SetMapper(view.mapper);
+            initLabel(view.label, view.folder.filename().string());
+
+            view.renderer->AddActor(view.actor);
+            view.renderer->AddViewProp(view.label);
+            view.renderer->SetBackground(primary.GetBackground());
+            view.renderer->SetActiveCamera(primary.GetActiveCamera());
+            view.renderer->SetViewport(static_cast<double>(i + 1) / viewportCount, 0, static_cast<double>(i + 2) / viewportCount, 1);
+            window.AddRenderer(view.renderer);
+        }
+    }
+
+    // Starts reading the colors of the compared datasets on the worker pool, finishLoading() shows them
+    void startLoading(int timestep, int colorAttribute, double mini, double maxi, Range pointFilter, bool derivatives) {
+        for (auto& view : views) {
+            auto task = std::make_shared<std::packaged_task<vtkSmartPointer<vtkUnsignedCharArray>()>>(
+                [=, folder = view->folder]() -> vtkSmartPointer<vtkUnsignedCharArray> {
+                    return loadColors(timestep, colorAttribute, mini, maxi, pointFilter, derivatives, folder).Get();
+                });
+            view->pending = task->get_future();
+            tasks.submit([task]() { (*task)(); }, 1);
+        }
+    }
+
+    void finishLoading() {
+        for (auto& view : views) {
+            if (!view->pending.valid()) continue;
+            view->colors = view->pending.get();
+            view->polyData->GetPointData()->SetScalars(view->colors);
+        }
+    }
+
+    // One position per neuron, the compared viewports always show every neuron with the colors of loadColors
+    void setPositions(vtkPoints* points) {
+        for (auto& view : views) {
+            view->polyData->SetPoints(points);
+        }
+    }
+
+    void setScaleFactor(double scale) {
+        for (auto& view : views) {
+            view->mapper->SetScaleFactor(scale);
+        }
+    }
+
+    size_t memoryBytes() const {
+        size_t result = 0;
+        for (auto& view : views) {
+            result += view->colors ? static_cast<size_t>(view->colors->GetActualMemorySize()) * 1024 : 0;
+        }
+        return result;
+    }
+};
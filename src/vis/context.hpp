@@ -2,15 +2,26 @@
 
 #include <vtkGenericOpenGLRenderWindow.h>
 #include <vtkRenderer.h>    
+#include <vtkTextActor.h>
+#include <vtkTextProperty.h>
 
 #include <vtkCamera.h>
+#include <vtkCallbackCommand.h>
+
+#include <chrono>
 
 #include "visUtility.hpp"
+#include "frameProfiler.hpp"
+#include "memoryRegistry.hpp"
 
 class Context{
 public:
     vtkNew<vtkRenderer> renderer;
     vtkNew<vtkGenericOpenGLRenderWindow> renderWindow;
+    // Recent stage timings and memory usage, toggled with F2
+    vtkNew<vtkTextActor> profilerOverlay;
+    vtkNew<vtkCallbackCommand> renderTimer;
+    std::chrono::steady_clock::time_point renderStart;
 
     void init(std::vector<vtkActor*> actors) {
         for (auto& actor : actors) {
@@ -33,7 +44,42 @@ public:
         // The render window is the actual GUI window
         // that appears on the computer screen
         renderWindow->AddRenderer(renderer);
-            
+
+        profilerOverlay->SetDisplayPosition(10, 10);
+        profilerOverlay->GetTextProperty()->SetFontFamilyToCourier();
+        profilerOverlay->GetTextProperty()->SetFontSize(14);
+        profilerOverlay->GetTextProperty()->SetColor(namedColors->GetColor3d("Black").GetData());
+        profilerOverlay->GetTextProperty()->SetBackgroundColor(namedColors->GetColor3d("White").GetData());
+        profilerOverlay->GetTextProperty()->SetBackgroundOpacity(0.7);
+        profilerOverlay->VisibilityOff();
+        renderer->AddViewProp(profilerOverlay);
+
+        // Renders triggered by the interactor don't go through render(), so they are timed by observing the window
+        renderTimer->SetClientData(this);
+        renderTimer->SetCallback([](vtkObject*, unsigned long eventId, void* clientData, void*) {
+            auto* self = static_cast<Context*>(clientData);
+            if (eventId == vtkCommand::StartEvent) {
+                if (self->profilerOverlay->GetVisibility()) {
+                    auto text = frameProfiler().report() + "\n" + memoryRegistry().report();
+                    self->profilerOverlay->SetInput(text.c_str());
+                }
+                self->renderStart = std::chrono::steady_clock::now();
+                traceRecorder().begin("render", self->renderStart);
+            }
+            else {
+                auto end = std::chrono::steady_clock::now();
+                std::chrono::duration<double, std::milli> elapsed = end - self->renderStart;
+                frameProfiler().record(ProfileStage::Render, elapsed.count());
+                traceRecorder().end("render", end);
+            }
+        });
+        renderWindow->AddObserver(vtkCommand::StartEvent, renderTimer);
+        renderWindow->AddObserver(vtkCommand::EndEvent, renderTimer);
+    }
+
+    void toggleProfilerOverlay() {
+        profilerOverlay->SetVisibility(!profilerOverlay->GetVisibility());
+        render();
     }
 
     void render() {
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vtkActor.h>
+#include <vtkArrowSource.h>
+#include <vtkFloatArray.h>
+#include <vtkGlyph3DMapper.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkProperty.h>
+
+#include <algorithm>
+#include <cmath>
+#include <span>
+
+#include "visUtility.hpp"
+#include "loaders.hpp"
+#include "edge.hpp"
+
+// Directed edges drawn as instances of one arrow mesh. Every edge only stores its source position, its direction and
+// its scale (length, width, width), the mapper draws all of them with one instanced draw call and places the arrow
+// in the vertex shader, so memory and upload time grow with the number of edges, not with the triangles of the arrow.
+class EdgeInstances {
+    vtkNew<vtkArrowSource> arrowSource;
+    vtkNew<vtkPolyData> instances;
+    vtkNew<vtkGlyph3DMapper> mapper;
+
+public:
+    vtkNew<vtkActor> actor;
+
+    EdgeInstances() {
+        arrowSource->SetShaftRadius(0.01);
+        arrowSource->SetTipRadius(0.02);
+
+        // The arrow points along x, it is scaled per component first and then rotated onto the edge
+        mapper->SetInputData(instances);
+        mapper->SetSourceConnection(arrowSource->GetOutputPort());
+        mapper->SetOrientationModeToDirection();
+        mapper->SetOrientationArray("direction");
+        mapper->SetScaleModeToScaleByVectorComponents();
+        mapper->SetScaleArray("scale");
+        mapper->ScalingOn();
+        mapper->ScalarVisibilityOff();
+
+        actor->SetMapper(mapper);
+        actor->GetProperty()->SetOpacity(0.75);
+        actor->GetProperty()->SetColor(namedColors->GetColor3d("DarkGray").GetData());
+    }
+
+    // One arrow from `from` to `to` of every edge, heavier edges are wider.
+    // Edges of clusters the positions don't contain, e.g. from an edge file of another layout, are skipped.
+    void update(vtkPoints& clusterPositions, std::span<const Edge> edges) {
+        auto positions = positionSpan(clusterPositions);
+        auto isDrawn = [&](const Edge& edge) { return edge.from < positions.size() && edge.to < positions.size(); };
+        auto count = static_cast<vtkIdType>(std::count_if(edges.begin(), edges.end(), isDrawn));
+
+        vtkNew<vtkPoints> points;
+        points->SetDataTypeToFloat();
+        points->SetNumberOfPoints(count);
+        vtkNew<vtkFloatArray> directions;
+        directions->SetName("direction");
+        directions->SetNumberOfComponents(3);
+        directions->SetNumberOfTuples(count);
+        vtkNew<vtkFloatArray> scales;
+        scales->SetName("scale");
+        scales->SetNumberOfComponents(3);
+        scales->SetNumberOfTuples(count);
+
+        auto* point = static_cast<float*>(points->GetVoidPointer(0));
+        auto* direction = directions->GetPointer(0);
+        auto* scale = scales->GetPointer(0);
+        size_t i = 0;
+        for (auto& edge : edges) {
+            if (!isDrawn(edge)) continue;
+            auto& from = positions[edge.from];
+            auto& to = positions[edge.to];
+            float d[3] = { to[0] - from[0], to[1] - from[1], to[2] - from[2] };
+            float length = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+            // Edges lighter than 4 aren't loaded, so the lightest ones keep the proportions of the arrow source
+            float width = length * std::min(std::sqrt(edge.weight / 4.0f), 3.0f);
+            for (int c = 0; c < 3; c++) {
+                point[3 * i + c] = from[c];
+                direction[3 * i + c] = d[c];
+            }
+            scale[3 * i] = length;
+            scale[3 * i + 1] = width;
+            scale[3 * i + 2] = width;
+            i++;
+        }
+
+        instances->SetPoints(points);
+        instances->GetPointData()->Initialize();
+        instances->GetPointData()->AddArray(directions);
+        instances->GetPointData()->AddArray(scales);
+        mapper->Update();
+    }
+
+    // VTK reports memory in KiB
+    size_t memoryBytes() {
+        return static_cast<size_t>(instances->GetActualMemorySize() + arrowSource->GetOutput()->GetActualMemorySize()) * 1024;
+    }
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <format>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "traceRecorder.hpp"
+
+// Stages of an update, timers of nested stages are counted in both
+enum class ProfileStage { Io, Histograms, ColorMapping, Upload, Update, Paint, Render, Count };
+
+inline const char* profileStageName(ProfileStage stage) {
+    switch (stage) {
+        case ProfileStage::Io: return "I/O";
+        case ProfileStage::Histograms: return "histograms";
+        case ProfileStage::ColorMapping: return "color mapping";
+        case ProfileStage::Upload: return "VTK upload";
+        case ProfileStage::Update: return "slot total";
+        case ProfileStage::Paint: return "widget paint";
+        case ProfileStage::Render: return "render";
+        default: return "";
+    }
+}
+
+// Keeps the most recent durations of every stage in a ring buffer, timers may run on any thread
+class FrameProfiler {
+public:
+    static constexpr size_t capacity = 256;
+    static constexpr size_t stageCount = static_cast<size_t>(ProfileStage::Count);
+
+    struct Summary {
+        size_t count = 0;
+        double p50 = 0;
+        double p95 = 0;
+        double max = 0;
+    };
+
+private:
+    struct Samples {
+        std::array<float, capacity> milliseconds{};
+        size_t count = 0;
+        size_t next = 0;
+    };
+
+    mutable std::mutex mutex;
+    std::array<Samples, stageCount> stages;
+
+public:
+    void record(ProfileStage stage, double milliseconds) {
+        std::lock_guard lock(mutex);
+        auto& samples = stages[static_cast<size_t>(stage)];
+        samples.milliseconds[samples.next] = static_cast<float>(milliseconds);
+        samples.next = (samples.next + 1) % capacity;
+        samples.count = std::min(samples.count + 1, capacity);
+    }
+
+    Summary summary(ProfileStage stage) const {
+        std::vector<float> sorted;
+        {
+            std::lock_guard lock(mutex);
+            auto& samples = stages[static_cast<size_t>(stage)];
+            sorted.assign(samples.milliseconds.begin(), samples.milliseconds.begin() + samples.count);
+        }
+        if (sorted.empty()) {
+            return {};
+        }
+        std::sort(sorted.begin(), sorted.end());
+        // Nearest rank percentiles
+        auto percentile = [&](double p) {
+            size_t rank = static_cast<size_t>(p * sorted.size() + 0.999999);
+            return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+        };
+        return { sorted.size(), percentile(0.5), percentile(0.95), sorted.back() };
+    }
+
+    // One line per stage that has samples
+    std::string report() const {
+        std::string result = std::format("{:<14} {:>8} {:>8} {:>8}\n", "stage [ms]", "p50", "p95", "max");
+        for (size_t i = 0; i < stageCount; i++) {
+            auto stage = static_cast<ProfileStage>(i);
+            auto s = summary(stage);
+            if (s.count == 0) continue;
+            result += std::format("{:<14} {:>8.2f} {:>8.2f} {:>8.2f}\n", profileStageName(stage), s.p50, s.p95, s.max);
+        }
+        return result;
+    }
+
+    void clear() {
+        std::lock_guard lock(mutex);
+        stages = {};
+    }
+};
+
+inline FrameProfiler& frameProfiler() {
+    static FrameProfiler profiler;
+    return profiler;
+}
+
+// Records the time between construction and destruction, and a trace event named `name` (a string literal) while tracing
+class ScopedTimer {
+    ProfileStage stage;
+    const char* name;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit ScopedTimer(ProfileStage stage, const char* name = nullptr) :
+        stage(stage),
+        name(name ? name : profileStageName(stage)),
+        start(std::chrono::steady_clock::now())
+    {
+        traceRecorder().begin(this->name, start);
+    }
+
+    ~ScopedTimer() {
+        auto end = std::chrono::steady_clock::now();
+        std::chrono::duration<double, std::milli> elapsed = end - start;
+        frameProfiler().record(stage, elapsed.count());
+        traceRecorder().end(name, end);
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
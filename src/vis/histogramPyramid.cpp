@@ -0,0 +1,84 @@
+#include "histogramPyramid.hpp"
+
+#include <algorithm>
+
+void HistogramPyramid::build(std::span<std::vector<int>> histogram, std::span<Statistics> summary) {
+    levels.clear();
+    timesteps = std::min(histogram.size(), summary.size());
+    binCount = histogram.empty() ? 0 : static_cast<int>(histogram[0].size());
+    if (timesteps == 0 || binCount == 0) {
+        return;
+    }
+
+    Level base;
+    base.span = 1;
+    base.columns = timesteps;
+    base.meanCounts.resize(timesteps * binCount);
+    for (size_t t = 0; t < timesteps; t++) {
+        std::copy(histogram[t].begin(), histogram[t].end(), base.meanCounts.begin() + t * binCount);
+    }
+    base.maxCounts = base.meanCounts;
+    base.meanSummary.assign(summary.begin(), summary.begin() + timesteps);
+    base.extremeSummary = base.meanSummary;
+    levels.push_back(std::move(base));
+
+    while (levels.back().columns > 1) {
+        levels.push_back(pool(levels.back()));
+    }
+}
+
+HistogramPyramid::Level HistogramPyramid::pool(const Level& finer) const {
+    Level result;
+    result.span = finer.span * 2;
+    result.columns = (finer.columns + 1) / 2;
+    result.meanCounts.resize(result.columns * binCount);
+    result.maxCounts.resize(result.columns * binCount);
+    result.meanSummary.resize(result.columns);
+    result.extremeSummary.resize(result.columns);
+
+    // Number of timesteps covered by a column of the finer level, only the last one can be partial
+    auto covered = [&](size_t column) {
+        return static_cast<double>(std::min<size_t>(finer.span, timesteps - column * finer.span));
+    };
+
+    for (size_t c = 0; c < result.columns; c++) {
+        size_t left = 2 * c;
+        size_t right = std::min(left + 1, finer.columns - 1);
+        double leftWeight = covered(left);
+        double rightWeight = right != left ? covered(right) : 0;
+        double total = leftWeight + rightWeight;
+
+        for (int bin = 0; bin < binCount; bin++) {
+            size_t l = left * binCount + bin;
+            size_t r = right * binCount + bin;
+            result.meanCounts[c * binCount + bin] = static_cast<float>((finer.meanCounts[l] * leftWeight + finer.meanCounts[r] * rightWeight) / total);
+            result.maxCounts[c * binCount + bin] = std::max(finer.maxCounts[l], finer.maxCounts[r]);
+        }
+
+        auto average = [&](const Statistics& a, const Statistics& b) {
+            return Statistics{
+                .mean = (a.mean * leftWeight + b.mean * rightWeight) / total,
+                .sum = (a.sum * leftWeight + b.sum * rightWeight) / total,
+                .min = (a.min * leftWeight + b.min * rightWeight) / total,
+                .max = (a.max * leftWeight + b.max * rightWeight) / total,
+            };
+        };
+        result.meanSummary[c] = average(finer.meanSummary[left], finer.meanSummary[right]);
+
+        auto& a = finer.extremeSummary[left];
+        auto& b = finer.extremeSummary[right];
+        result.extremeSummary[c] = average(a, b);
+        result.extremeSummary[c].min = std::min(a.min, b.min);
+        result.extremeSummary[c].max = std::max(a.max, b.max);
+    }
+    return result;
+}
+
+const HistogramPyramid::Level& HistogramPyramid::levelFor(size_t maxColumns) const {
+    for (auto& level : levels) {
+        if (level.columns <= maxColumns) {
+            return level;
+        }
+    }
+    return levels.back();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "visUtility.hpp"
+
+// Temporal mip pyramid over the histogram and summary tables of one attribute.
+// Level k pools 2^k consecutive timesteps into one column, so an overview of any width reads a single level.
+// Every level keeps mean and max pooled bin counts, max pooling keeps short spikes visible when zoomed out.
+class HistogramPyramid {
+public:
+    struct Level {
+        // Timesteps per column, the last column may cover fewer
+        int span = 1;
+        size_t columns = 0;
+        // columns * binCount
+        std::vector<float> meanCounts;
+        std::vector<float> maxCounts;
+        // All fields averaged over the column
+        std::vector<Statistics> meanSummary;
+        // Minimum of minimums and maximum of maximums, mean and sum are averaged
+        std::vector<Statistics> extremeSummary;
+    };
+
+    void build(std::span<std::vector<int>> histogram, std::span<Statistics> summary);
+
+    bool empty() const { return levels.empty(); }
+
+    int getBinCount() const { return binCount; }
+
+    size_t memoryBytes() const {
+        size_t result = 0;
+        for (auto& level : levels) {
+            result += (level.meanCounts.capacity() + level.maxCounts.capacity()) * sizeof(float)
+                + (level.meanSummary.capacity() + level.extremeSummary.capacity()) * sizeof(Statistics);
+        }
+        return result;
+    }
+
+    // Finest level with at most `maxColumns` columns
+    const Level& levelFor(size_t maxColumns) const;
+
+private:
+    int binCount = 0;
+    size_t timesteps = 0;
+    std::vector<Level> levels;
+
+    Level pool(const Level& finer) const;
+};
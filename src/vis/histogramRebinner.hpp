@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "loaders.hpp"
+#include "neuronHistory.hpp"
+#include "workerPool.hpp"
+
+// Recomputes value histograms for arbitrary value ranges and bin counts on the shared worker pool.
+// Only the newest request is computed, older queued requests are dropped and results of superseded
+// requests can be recognized by their generation.
+class HistogramRebinner {
+public:
+    using Callback = std::function<void(uint64_t generation, int attribute, AttributeTables tables)>;
+
+private:
+    NeuronHistoryStore& store;
+    Callback finished;
+    std::atomic<uint64_t> generation = 0;
+    TaskGroup tasks;
+
+public:
+    // `finished` is called on a worker thread
+    HistogramRebinner(NeuronHistoryStore& store, Callback finished) :
+        store(store),
+        finished(std::move(finished)) { }
+
+    ~HistogramRebinner() {
+        generation++;
+        tasks.cancelAndWait();
+    }
+
+    HistogramRebinner(const HistogramRebinner& other) = delete;
+    HistogramRebinner& operator=(const HistogramRebinner& other) = delete;
+
+    // Histograms of `neurons` (all neurons when empty) with `binCount` bins over `valueRange`, returns the generation of the request
+    uint64_t request(int attribute, Range valueRange, int binCount, std::vector<uint32_t> neurons) {
+        uint64_t current = ++generation;
+        tasks.cancel();
+        // Interactive requests go before background loading
+        tasks.submit([this, current, attribute, valueRange, binCount, neurons = std::move(neurons)]() {
+            if (current != generation) return;
+
+            auto table = store.table(attribute);
+            auto timestepCount = store.timestepCount(attribute);
+            auto tables = computeAttributeTables(table, timestepCount, neurons, valueRange, binCount);
+
+            if (current == generation) {
+                finished(current, attribute, std::move(tables));
+            }
+        }, 2);
+        return current;
+    }
+
+    // Drops the queued request and marks the running one as superseded
+    void cancel() {
+        generation++;
+        tasks.cancel();
+    }
+
+    bool isCurrent(uint64_t requestGeneration) const {
+        return requestGeneration == generation;
+    }
+};
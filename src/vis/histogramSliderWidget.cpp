@@ -1,61 +1,75 @@
 #include "histogramSliderWidget.hpp"
 #include "magmaColormap.hpp"
+#include "frameProfiler.hpp"
 
 #include <QPainter>
 #include <QMouseEvent>
 
+#include <algorithm>
+
 
 
 HistogramSliderWidget::HistogramSliderWidget(QWidget* parent) : HistogramWidget(parent)
 {
-	setVisibleRange(0, 9999);
+	setVisibleRange(0, static_cast<int>(dataset().timestepCount) - 1);
 }
 
 void HistogramSliderWidget::paintEvent(QPaintEvent* event)
 {
-    QPainter painter(this);
-    if (antialiased) painter.setRenderHint(QPainter::Antialiasing, true);
-
-    dataBinSize = tickSize * getVisibleTicks() / geometry().width();
-
-    switch (drawMode) {
-    case Summary:
-        paintSummary(painter, true);
-        break;
-    case Histogram:
-        paintHistogram(painter);
-        break;
-    case Both:
-        paintHistogram(painter);
-        paintSummary(painter, false);
-        break;
+    if (!isLoaded() || pyramid.empty())
+        return;
+
+    ScopedTimer timer(ProfileStage::Paint, "HistogramSliderWidget::paintEvent");
+
+    if (!frameValid || frameKey != currentFrameKey()) {
+        renderFrame();
     }
 
-    fastRepaint = false;
+    QPainter painter(this);
+    painter.drawImage(0, 0, frame);
 
     QColor black = { 0, 0, 0 };
     black.setAlphaF(0.3);
     QBrush brush = QBrush(black);
     
-    int lowerBoundary = std::max(tick - 250, firstVisibleTick);
-    int upperBoundary = std::min(tick + 250, lastVisibleTick);
+    // Same window as Visualisation::changeTimestepRange
+    const int window = std::min(500, lastVisibleTick - firstVisibleTick);
+    int lowerBoundary = std::max(tick - window / 2, firstVisibleTick);
+    int upperBoundary = std::min(tick + window / 2, lastVisibleTick);
 
-    if (lowerBoundary == firstVisibleTick) upperBoundary = 500;
-    if (upperBoundary == lastVisibleTick) lowerBoundary = lastVisibleTick - 500;
+    if (lowerBoundary == firstVisibleTick) upperBoundary = firstVisibleTick + window;
+    if (upperBoundary == lastVisibleTick) lowerBoundary = lastVisibleTick - window;
     painter.fillRect(getXPos(lowerBoundary), 0, getXPos(upperBoundary) - getXPos(lowerBoundary), geometry().height(), brush);
 
     int x = getXPos(tick);
     painter.drawLine(x, 0, x, geometry().height());
 }
 
+// The overview reads the one pyramid level that has at most one column per pixel
+void HistogramSliderWidget::renderFrame()
+{
+    frameKey = currentFrameKey();
+    frameValid = true;
+    frame = QImage(size(), QImage::Format_RGB32);
+    frame.fill(Qt::white);
+
+    auto& level = pyramid.levelFor(std::max(1, width()));
+    if (drawMode != Summary) {
+        paintHistogram(frame, level);
+    }
+    if (drawMode != Histogram) {
+        QPainter painter(&frame);
+        if (antialiased) painter.setRenderHint(QPainter::Antialiasing, true);
+        paintSummary(painter, level);
+    }
+}
+
 void HistogramSliderWidget::mousePressEvent(QMouseEvent* e)
 {
     if (e->buttons() & Qt::LeftButton) {
         double pos = std::clamp(e->position().x(), 0.0, (double)geometry().width());
         setTick(round((pos / (double)geometry().width()) * getVisibleTicks()) + firstVisibleTick);
         histogramCursorMoved(tick);
-
-        fastRepaint = true;
         update();
     }
 }
@@ -66,64 +80,48 @@ void HistogramSliderWidget::mouseMoveEvent(QMouseEvent* e)
         double pos = std::clamp(e->position().x(), 0.0, (double)geometry().width());
         setTick(round((pos / (double)geometry().width()) * getVisibleTicks()) + firstVisibleTick);
         histogramCursorMoved(tick);
-
-        fastRepaint = true;
         update();
     }
 }
 
-void HistogramSliderWidget::paintHistogram(QPainter& painter)
+void HistogramSliderWidget::paintHistogram(QImage& image, const HistogramPyramid::Level& level)
 { 
-    float binSize = (float)geometry().height() / (float) getBinCount();
-
-    // TODO Use PixMap!
-    if (!fastRepaint) {
-        std::cout << getBinCount() << std::endl;
-        for (int x = firstVisibleTick; x <= lastVisibleTick - dataBinSize; x += dataBinSize) {
-            paintHistogramTick(painter, x, binSize, tickSize);
-        }
+    int width = image.width();
+    int height = image.height();
+    int binCount = pyramid.getBinCount();
+    if (width <= 0 || height <= 0 || getVisibleTicks() <= 0) {
+        return;
     }
-    else {
-        previousTicks.push_back(tick);
-        for (int previous : previousTicks) {
-            int lowerBoundary = std::max(previous - 250, firstVisibleTick);
-            int upperBoundary = std::min(previous + 250, lastVisibleTick);
-
-            if (lowerBoundary == firstVisibleTick) upperBoundary = 500;
-            if (upperBoundary == lastVisibleTick) lowerBoundary = lastVisibleTick - 500;
-            
-            for (int x = lowerBoundary; x <= upperBoundary; x += dataBinSize) {
-                if (x + dataBinSize >= lastVisibleTick) continue;
-                paintHistogramTick(painter, x, binSize, tickSize);
-            }
-        }
-        if (drawMode != Both) {
-            previousTicks.clear();
+
+    float binSize = (float)height / (float)binCount;
+    double logMax = log(max) + 1;
+    auto& counts = preserveSpikes ? level.maxCounts : level.meanCounts;
+
+    std::vector<QRgb> colors(counts.size());
+    for (size_t i = 0; i < counts.size(); i++) {
+        double v = counts[i] / (max + 1);
+        if (logarithmicScaleEnabled) {
+            v = std::fmax(0, log(counts[i]) + 1) / logMax;
         }
+        colors[i] = magmaRgbMap[static_cast<int>(std::clamp(v, 0.0, 1.0) * 255)];
     }
-}
-
-void HistogramSliderWidget::paintHistogramTick(QPainter& painter, int x, float binSize, float tickSize)
-{
-    for (int y = 0; y < getBinCount(); y++) {
-        int y_pos = int(getBinCount()) - y - 1;
-        double val = 0;
-        for (int i = 0; i < dataBinSize; i++) {
-            double v = histogramTable[x + i][y] / (max + 1);
 
-            if (logarithmicScaleEnabled) {
-                v = std::fmax(0, log(histogramTable[x + i][y]) + 1) / (log(max) + 1);
-            }
+    std::vector<size_t> columnOffsets(width);
+    for (int x = 0; x < width; x++) {
+        size_t tick = firstVisibleTick + static_cast<size_t>(x) * getVisibleTicks() / width;
+        columnOffsets[x] = std::min(tick / level.span, level.columns - 1) * binCount;
+    }
 
-            val += v;
+    for (int y = 0; y < height; y++) {
+        int bin = binCount - 1 - std::min(static_cast<int>(y / binSize), binCount - 1);
+        auto* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < width; x++) {
+            line[x] = colors[columnOffsets[x] + bin];
         }
-        QColor color = getMagmaColor(val / dataBinSize);
-        painter.setBrush(QBrush(color));
-        painter.fillRect(getXPos(x), y_pos * binSize, tickSize, binSize + 1, painter.brush());
     }
 }
 
-void HistogramSliderWidget::paintSummary(QPainter& painter, bool redraw)
+void HistogramSliderWidget::paintSummary(QPainter& painter, const HistogramPyramid::Level& level)
 { 
     QPen black = QPen({ 0,   0, 0 });
     QPen blue = QPen({ 0,   0, 255 });
@@ -131,73 +129,29 @@ void HistogramSliderWidget::paintSummary(QPainter& painter, bool redraw)
     black.setWidth(2);
     blue.setWidth(2);
     red.setWidth(2);
-    // TODO Use PixMap?
-    if (!fastRepaint) {
-        if (redraw) {
-            painter.fillRect(0, 0, geometry().width(), geometry().height(), QBrush({ 255, 255, 255 }));
-        }
-
-        for (int i = firstVisibleTick; i < lastVisibleTick; i += dataBinSize) {
-            paintSummaryTick(painter, i, tickSize, black, blue, red);
-        }
-    }
-    else {
-        for (int previous : previousTicks) {
-            int lowerBoundary = std::max(previous - 250, firstVisibleTick);
-            int upperBoundary = std::min(previous + 250, lastVisibleTick);
-            if (lowerBoundary == firstVisibleTick) upperBoundary = 500;
-            if (upperBoundary == lastVisibleTick) lowerBoundary = lastVisibleTick - 500;
-
-
-            if (redraw) {
-                painter.fillRect(getXPos(lowerBoundary), 0, getXPos(upperBoundary) - getXPos(lowerBoundary), geometry().height(), QBrush({255, 255, 255}));
-            }
-
-            for (int x = lowerBoundary; x <= upperBoundary; x += dataBinSize) {
-                if (x + dataBinSize >= lastVisibleTick) continue;
-                paintSummaryTick(painter, x, tickSize, black, blue, red);
-            }
-        }
-        previousTicks.clear();
-    }
-    
-}
 
-void HistogramSliderWidget::paintSummaryTick(QPainter& painter, int tick, float tickSize, QPen& black, QPen& blue, QPen& red)
-{
-    int x0 = getXPos(tick);
-    int x1 = getXPos(tick + dataBinSize);
+    auto& means = level.meanSummary;
+    auto& bounds = preserveSpikes ? level.extremeSummary : level.meanSummary;
 
-    double max1 = 0.0, val1 = 0.0, min1 = 0.0, max2 = 0.0, val2 = 0.0, min2 = 0.0;
+    size_t firstColumn = firstVisibleTick / level.span;
+    size_t lastColumn = std::min(static_cast<size_t>(lastVisibleTick / level.span), level.columns - 1);
+    auto columnX = [&](size_t column) {
+        return getXPos((column + 0.5) * level.span - firstVisibleTick);
+    };
 
-    int n = 0;
-    for (int b = 0; b < dataBinSize; b++) {
-        if (tick + b + dataBinSize >= summaryTable.size()) {
-            break;
-        }
-        max1 += summaryTable[tick + b].max;
-        min1 += summaryTable[tick + b].min;
-        val1 += summaryTable[tick + b].mean;
-        max2 += summaryTable[tick + b + dataBinSize].max;
-        min2 += summaryTable[tick + b + dataBinSize].min;
-        val2 += summaryTable[tick + b + dataBinSize].mean;
-        n++;
-    }
-    max1 /= n;
-    max2 /= n;
-    val1 /= n;
-    val2 /= n;
-    min1 /= n;
-    min2 /= n;
+    for (size_t c = firstColumn; c < lastColumn; c++) {
+        int x0 = columnX(c);
+        int x1 = columnX(c + 1);
 
-    painter.setPen(red);
-    painter.drawLine(x0, getYPos(max1), x1, getYPos(max2));
+        painter.setPen(red);
+        painter.drawLine(x0, getYPos(bounds[c].max), x1, getYPos(bounds[c + 1].max));
 
-    painter.setPen(blue);
-    painter.drawLine(x0, getYPos(min1), x1, getYPos(min2));
+        painter.setPen(blue);
+        painter.drawLine(x0, getYPos(bounds[c].min), x1, getYPos(bounds[c + 1].min));
 
-    painter.setPen(black);
-    painter.drawLine(x0, getYPos(val1), x1, getYPos(val2));
+        painter.setPen(black);
+        painter.drawLine(x0, getYPos(means[c].mean), x1, getYPos(means[c + 1].mean));
+    }
 }
 
 int HistogramSliderWidget::getXPos(double val)
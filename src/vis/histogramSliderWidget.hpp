@@ -1,6 +1,8 @@
 #pragma once 
 
 #include "histogramWidget.hpp"
+#include "histogramPyramid.hpp"
+#include "datasetDescriptor.hpp"
 
 #include <QWidget>
 #include <QObject>
@@ -19,7 +21,7 @@ class HistogramSliderLabelWidget : public QWidget {
     QSpacerItem* spacer;
 
     void adjustSpacerWidth(int newWidth) {
-        auto spacerWidth = (newWidth - label->width()) * timestep / 10000;
+        auto spacerWidth = static_cast<int>(static_cast<int64_t>(newWidth - label->width()) * timestep / dataset().timestepCount);
         spacer->changeSize(spacerWidth, 0, QSizePolicy::Fixed);
     }
 public:
@@ -44,7 +46,7 @@ public:
     void setTimestep(int timestep) {
         this->timestep = timestep;
         adjustSpacerWidth(width());
-        label->setText(QString::fromStdString(std::to_string(timestep * 100)));
+        label->setText(QString::fromStdString(std::to_string(dataset().simulationStep(timestep))));
     }
 
     void resizeEvent(QResizeEvent* event) override {
@@ -58,21 +60,33 @@ class HistogramSliderWidget : public HistogramWidget
     Q_OBJECT
 
 public:
+    // Pooling keeps the peak of every bin and the extremes of the summary instead of averages
+    bool preserveSpikes = true;
+
     HistogramSliderWidget(QWidget* parent = nullptr);
 
+    void setTableData(std::span<std::vector<int>> histogram, std::span<Statistics> summary, Statistics globalSummary) {
+        HistogramWidget::setTableData(histogram, summary, globalSummary);
+        // One tick per timestep
+        setVisibleRange(0, std::max(static_cast<int>(histogram.size()) - 1, 1));
+        pyramid.build(histogram, summary);
+    }
+
+    size_t memoryBytes() const {
+        return HistogramWidget::memoryBytes() + pyramid.memoryBytes();
+    }
+
 protected:
     void paintEvent(QPaintEvent* event) override;
     void mousePressEvent(QMouseEvent*) override;
     void mouseMoveEvent(QMouseEvent*) override;
 
 private:
-    int dataBinSize = 0;
-    int tickSize = 1;
+    HistogramPyramid pyramid;
 
-    void paintHistogram(QPainter& painter);
-    void paintHistogramTick(QPainter& painter, int tick, float binSize, float tickSize);
-    void paintSummary(QPainter& painter, bool redraw);
-    void paintSummaryTick(QPainter& painter, int tick, float tickSize, QPen& black, QPen& blue, QPen& red);
+    void renderFrame();
+    void paintHistogram(QImage& image, const HistogramPyramid::Level& level);
+    void paintSummary(QPainter& painter, const HistogramPyramid::Level& level);
 
     int getXPos(double val);
 
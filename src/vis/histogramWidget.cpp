@@ -2,13 +2,14 @@
 // SPDX-License-Identifier: LicenseRef-Qt-Commercial OR BSD-3-Clause
 
 #include "histogramWidget.hpp"
-#include <iostream>
 
 #include <QPainter>
+#include <algorithm>
 #include <QPainterPath>
 #include <QMouseEvent>
 
 #include "magmaColormap.hpp"
+#include "frameProfiler.hpp"
 
 //! [0]
 HistogramWidget::HistogramWidget(QWidget *parent)
@@ -42,7 +43,7 @@ void HistogramWidget::paintSummaryTick(QPainter& painter, int tick, float tickSi
     painter.drawLine(x0, getYPos(summaryTable[tick].mean), x1, getYPos(summaryTable[tick + 1].mean));
 }
 
-void HistogramWidget::paintSummary(QPainter& painter, bool redraw) {
+void HistogramWidget::paintSummary(QPainter& painter) {
     float tickSize = (float)geometry().width() / (float)getVisibleTicks();
     
     QPen black = QPen({ 0,   0, 0   });
@@ -51,70 +52,66 @@ void HistogramWidget::paintSummary(QPainter& painter, bool redraw) {
     black.setWidth(2);
     blue.setWidth(2);
     red.setWidth(2);
-    // TODO Use PixMap?
-    if (!fastRepaint) {
-        if (redraw) {
-            painter.fillRect(0, 0, geometry().width(), geometry().height(), QBrush({ 255, 255, 255 }));
-        }
-        
-        for (int i = firstVisibleTick; i <= lastVisibleTick - 1; i++) {
-            paintSummaryTick(painter, i, tickSize, black, blue, red);
-        }
-    }
-    else {
-        for (int previousTick : previousTicks) {
-            int x0 = (previousTick - firstVisibleTick) * tickSize;
-            int x1 = (previousTick + 1 - firstVisibleTick) * tickSize;
 
-            if (redraw) {
-                painter.fillRect(x0, 0, tickSize, geometry().height(), QBrush({ 255, 255, 255 }));
-            }
-
-            paintSummaryTick(painter, previousTick, tickSize, black, blue, red);
-        }
-        previousTicks.clear();
+    for (int i = firstVisibleTick; i <= lastVisibleTick - 1; i++) {
+        paintSummaryTick(painter, i, tickSize, black, blue, red);
     }
 }
 
-void HistogramWidget::paintHistogramTick(QPainter& painter, int tick, float binSize, float tickSize) {
-    for (int y = 0; y < getBinCount(); y++) {
-        int y_pos = getBinCount() - y - 1;
-        double v = histogramTable[tick][y] / (max + 1);
+// Writes the heatmap pixels directly, every visible tick is converted to colors once and then spread over its columns
+void HistogramWidget::paintHistogram(QImage& image) {
+    int width = image.width();
+    int height = image.height();
+    int binCount = static_cast<int>(getBinCount());
+    int lastTick = std::min(lastVisibleTick, static_cast<int>(getTimesteps()) - 1);
+    if (width <= 0 || height <= 0 || binCount == 0 || lastTick < firstVisibleTick) {
+        return;
+    }
 
-        if (logarithmicScaleEnabled) {
-            v = std::fmax(0, log(histogramTable[tick][y]) + 1) / (log(max) + 1);
+    float tickSize = (float)width / (float)getVisibleTicks();
+    float binSize = (float)height / (float)binCount;
+    double logMax = log(max) + 1;
+
+    std::vector<QRgb> tickColors(static_cast<size_t>(lastTick - firstVisibleTick + 1) * binCount);
+    for (int tick = firstVisibleTick; tick <= lastTick; tick++) {
+        QRgb* colors = tickColors.data() + static_cast<size_t>(tick - firstVisibleTick) * binCount;
+        for (int bin = 0; bin < binCount; bin++) {
+            double v = histogramTable[tick][bin] / (max + 1);
+            if (logarithmicScaleEnabled) {
+                v = std::fmax(0, log(histogramTable[tick][bin]) + 1) / logMax;
+            }
+            colors[bin] = magmaRgbMap[static_cast<int>(std::clamp(v, 0.0, 1.0) * 255)];
         }
-
-        QColor color = getMagmaColor(v);
-        painter.setBrush(QBrush(color));
-        painter.fillRect((tick - firstVisibleTick) * tickSize, y_pos * binSize, tickSize + 1, binSize + 1, painter.brush());
     }
-}
-
 
-void HistogramWidget::paintHistogram(QPainter& painter) {  
-    float tickSize = (float) geometry().width() / (float) getVisibleTicks();
-    float binSize = (float) geometry().height() / (float) getBinCount();
-    
-    std::cout << "Bins:" << getBinCount() << ", Steps: " << getVisibleTicks() << "\n";
-    std::cout << "BinSize:" << binSize << ", TimestepSize: " << tickSize << "\n";
-    
-    // TODO Use PixMap!
-    if (!fastRepaint) {
-        for (int x = firstVisibleTick; x <= lastVisibleTick; x++) {
-            paintHistogramTick(painter, x, binSize, tickSize);
-        }
+    std::vector<int> columnOffsets(width);
+    for (int x = 0; x < width; x++) {
+        int tick = std::min(static_cast<int>(x / tickSize), lastTick - firstVisibleTick);
+        columnOffsets[x] = tick * binCount;
     }
-    else {
-        for (int previousTick : previousTicks) {
-            paintHistogramTick(painter, previousTick, binSize, tickSize);
-        }
 
-        if (drawMode != Both) {
-            previousTicks.clear();
+    for (int y = 0; y < height; y++) {
+        int bin = binCount - 1 - std::min(static_cast<int>(y / binSize), binCount - 1);
+        auto* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < width; x++) {
+            line[x] = tickColors[columnOffsets[x] + bin];
         }
     }
+}
 
+void HistogramWidget::renderFrame() {
+    frameKey = currentFrameKey();
+    frameValid = true;
+    frame = QImage(size(), QImage::Format_RGB32);
+    frame.fill(Qt::white);
+    if (drawMode != Summary) {
+        paintHistogram(frame);
+    }
+    if (drawMode != Histogram) {
+        QPainter painter(&frame);
+        if (antialiased) painter.setRenderHint(QPainter::Antialiasing, true);
+        paintSummary(painter);
+    }
 }
 
 void HistogramWidget::paintEvent(QPaintEvent * /* event */)
@@ -122,28 +119,15 @@ void HistogramWidget::paintEvent(QPaintEvent * /* event */)
     if(!isLoaded())
         return;
 
-    QPainter painter(this);
+    ScopedTimer timer(ProfileStage::Paint, "HistogramWidget::paintEvent");
 
-    if (antialiased) painter.setRenderHint(QPainter::Antialiasing, true);
-    
-    //std::cout << "DrawMode: " << drawMode <<" \n";
-    switch (drawMode) {
-    case Summary:
-        paintSummary(painter, true);
-        painter.setPen(QPen({ 0, 255, 0 }));
-        break;
-    case Histogram:
-        paintHistogram(painter);
-        painter.setPen(QPen({ 255, 255, 255 }));
-        break;
-    case Both:
-        paintHistogram(painter);
-        painter.setPen(QPen({ 255, 255, 255 }));
-        paintSummary(painter, false);
-        painter.setPen(QPen({ 0, 255, 0 }));
-        break;
+    // Cursor moves and expose events only blit the cached frame
+    if (!frameValid || frameKey != currentFrameKey()) {
+        renderFrame();
     }
-    fastRepaint = false;
+
+    QPainter painter(this);
+    painter.drawImage(0, 0, frame);
 
     float tickSize =  (float) geometry().width() / (float) getVisibleTicks();
     int x = (tick - firstVisibleTick) * tickSize;
@@ -156,8 +140,6 @@ void HistogramWidget::mousePressEvent(QMouseEvent* e) {
         double pos = std::clamp(e->position().x(), 0.0, (double) geometry().width());
         setTick(round(pos / tickSize) + firstVisibleTick);
         histogramCursorMoved(tick);
-
-        fastRepaint = true;
         update();
     }
 }
@@ -173,8 +155,6 @@ void HistogramWidget::mouseMoveEvent(QMouseEvent* e) {
         double pos = std::clamp(e->position().x(), 0.0, (double)geometry().width());
         setTick(round(pos / tickSize) + firstVisibleTick);
         histogramCursorMoved(tick);
-
-        fastRepaint = true;
         update();
     }
 }
@@ -187,20 +167,17 @@ void HistogramWidget::keyPressEvent(QKeyEvent* e) {
     if (e->key() == Qt::Key_Left || e->key() == Qt::Key_A)  {
         setTick(std::max(firstVisibleTick, tick - 1));
         histogramCursorMoved(tick);
-        fastRepaint = true;
         update();
     }
     else if (e->key() == Qt::Key_Right || e->key() == Qt::Key_D) {
         setTick(std::min(lastVisibleTick, tick + 1));
         histogramCursorMoved(tick);
-        fastRepaint = true;
         update();
     }
 }
 
 
 void HistogramWidget::setTick(int newTick) {
-    previousTicks.emplace_back(tick);
     tick = newTick;
     update();
 }
@@ -214,6 +191,4 @@ void HistogramWidget::recomputeMinMax() {
             min = std::fmin(min, histogramTable[i][j]);
         }
     }
-
-    std::cout << "max: " << max << ", min: " << min<< "\n";
 }
\ No newline at end of file
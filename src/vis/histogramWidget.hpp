@@ -5,6 +5,7 @@
 #define HISTOGRAM_WIDGET_H
 
 #include <QBrush>
+#include <QImage>
 #include <QPen>
 #include <QPixmap>
 #include <QWidget>
@@ -52,6 +53,7 @@ public:
         this->propertyMax = globalSummary.max;
 
         loaded = true;
+        frameValid = false;
         recomputeMinMax();
     }
     
@@ -59,6 +61,11 @@ public:
         return loaded;
     }
 
+    // Cached frame, the tables belong to the caller
+    size_t memoryBytes() const {
+        return static_cast<size_t>(frame.sizeInBytes());
+    }
+
     void changeDrawMode(HistogramDrawMode drawModeParam) {
         std::cout << "DrawMode: " << drawMode <<" \n";
         drawMode = drawModeParam;
@@ -71,7 +78,6 @@ signals:
 
 protected:
     bool antialiased = true;
-    bool fastRepaint = false;
     bool loaded = false;
     
     std::span<std::vector<int>> histogramTable{};
@@ -81,20 +87,39 @@ protected:
 
     HistogramDrawMode drawMode = Histogram;
     int tick = 1;
-    std::vector<int> previousTicks;
     int firstVisibleTick = 0;
     int lastVisibleTick = 500;
 
     double min = NAN;
     double max = NAN;
+
+    // Everything the cached frame depends on, the frame is rendered again only when this changes
+    struct FrameKey {
+        bool logarithmic = false;
+        HistogramDrawMode drawMode = Histogram;
+        int firstVisibleTick = 0;
+        int lastVisibleTick = 0;
+        QSize size;
+
+        bool operator==(const FrameKey&) const = default;
+    };
+
+    // Heatmap and summary of the visible range without the cursor
+    QImage frame;
+    FrameKey frameKey;
+    bool frameValid = false;
+
+    FrameKey currentFrameKey() const {
+        return { logarithmicScaleEnabled, drawMode, firstVisibleTick, lastVisibleTick, size() };
+    }
     
     int getYPos(double value);
 
     void paintEvent(QPaintEvent *event) override;
 
-    void paintHistogram(QPainter& painter);
-    void paintHistogramTick(QPainter& painter, int tick, float binSize, float tickSize);
-    void paintSummary(QPainter& painter, bool redraw);
+    void renderFrame();
+    void paintHistogram(QImage& image);
+    void paintSummary(QPainter& painter);
     void paintSummaryTick(QPainter& painter, int tick, float tickSize, QPen& black, QPen& blue, QPen& red);
     void paintMinMaxLabels(QPainter &painter, QColor color);
 
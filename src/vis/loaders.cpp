@@ -18,10 +18,13 @@
 #include <vtkEdgeLayout.h>
 #include <vtkSmartPointer.h>
 #include <vtkVariantArray.h>
-#include <random>
 
 #include <QColor>
 
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <limits>
 #include <vector>
 #include <span>
 #include <ranges>
@@ -29,9 +32,13 @@
 
 #include "../utility.hpp"
 #include "../edge.hpp"
+#include "../spatialIndex.hpp"
+#include "../positionLayout.hpp"
+#include "../datasetDescriptor.hpp"
 #include "binaryReader.hpp"
 #include "neuronProperties.hpp"
 #include "visUtility.hpp"
+#include "frameProfiler.hpp"
 
 #include "loaders.hpp"
 
@@ -39,83 +46,6 @@ namespace ranges = std::ranges;
 
 namespace {
 
-    struct Point3 {
-        double x;
-        double y;
-        double z;
-
-        Point3(double x, double y, double z) {
-            this->x = x;
-            this->y = y;
-            this->z = z;
-        }
-
-        void add(Point3 b) {
-            x += b.x;
-            y += b.y;
-            z += b.z;
-        }
-
-        double size() {
-            return sqrt(x * x + y * y + z * z);
-        }
-
-        void scale(double scale) {
-            x *= scale;
-            y *= scale;
-            z *= scale;
-        }
-
-        void normalize() {
-            double size = this->size();
-            x /= size;
-            y /= size;
-            z /= size;
-        }
-
-        static double dist(Point3 a, Point3 b) {
-            return sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y) + (a.z - b.z) * (a.z - b.z));
-        }
-
-        static Point3 cross(Point3 a, Point3 b) {
-            return Point3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
-        }
-
-        static Point3 vector(Point3 a, Point3 b) {
-            Point3 p = Point3(a.x - b.x, a.y - b.y, a.z - b.z);
-            p.normalize();
-            return p;
-        }
-
-    };
-
-    std::vector<Point3> findClosestPoints(int index, std::vector<Point3>& points) {
-        std::vector<Point3> closePoints{ Point3(0.0, 0.0, 0.0), Point3(0.0, 0.0, 0.0), Point3(0.0, 0.0, 0.0), Point3(0.0, 0.0, 0.0) };
-        std::vector<double> distances{ 500.0, 500.0, 500.0, 500.0 };
-
-        for (int i = 0; i < points.size(); i++) {
-            if (i == index) continue;
-
-            double dist = Point3::dist(points[index], points[i]);
-            int pointsId = -1;
-            int distId = -1;
-            double bestDist = 0;
-            for (int j = 0; j < 4; j++) {
-                if (dist < distances[j] && distances[j] > bestDist) {
-                    bestDist = distances[j];
-                    pointsId = i;
-                    distId = j;
-                }
-            }
-
-            if (pointsId != -1) {
-                closePoints[distId] = points[pointsId];
-                distances[distId] = Point3::dist(points[pointsId], points[index]);
-            }
-        }
-        return closePoints;
-    }
-
     Statistics computeGlobalStatistics(std::span<Statistics> summaryTable) {
         namespace ranges = std::ranges;
         
@@ -143,259 +73,350 @@ namespace {
 
 
 
-void loadPositions(vtkPoints& originalPositions, vtkPoints& scatteredPositions, vtkPoints& aggregatedPositions, std::vector<uint16_t>& mapping) {
-    vtkNew<vtkDelimitedTextReader> reader;
-    std::string path = (dataFolder / "positions/rank_0_positions.txt").string();
-    reader->SetFileName(path.data());
-    reader->DetectNumericColumnsOn();
-    reader->SetFieldDelimiterCharacters(" ");
-    reader->Update();
+void copyPositions(vtkPoints& points, std::span<const Position> positions) {
+    points.SetDataTypeToFloat();
+    points.SetNumberOfPoints(positions.size());
+    std::memcpy(points.GetVoidPointer(0), positions.data(), positions.size_bytes());
+    points.Modified();
+}
 
-    int point_index = 0;
-    vtkTable* table = reader->GetOutput();
+std::span<const Position> positionSpan(vtkPoints& points) {
+    assert(points.GetDataType() == VTK_FLOAT);
+    return { static_cast<const Position*>(points.GetVoidPointer(0)), static_cast<size_t>(points.GetNumberOfPoints()) };
+}
 
-    // First find index of first row that is not a header/comment
-    int begin = 0;
-    for (vtkIdType i = 0; i < table->GetNumberOfRows(); i++) {
-        if (table->GetValue(i, 0).ToString() != "#") {
-            begin = i;
-            break;
-        }
-    }
+std::span<const Rgba> colorSpan(vtkUnsignedCharArray& colors) {
+    assert(colors.GetNumberOfComponents() == 4);
+    return { reinterpret_cast<const Rgba*>(colors.GetPointer(0)), static_cast<size_t>(colors.GetNumberOfTuples()) };
+}
 
-    mapping.resize(table->GetNumberOfRows());
-    std::vector<Point3> averagePoints;
-    Point3 current = Point3((table->GetValue(begin, 1)).ToDouble(), (table->GetValue(begin, 2)).ToDouble(), (table->GetValue(begin, 3)).ToDouble());
-    Point3 average = Point3(0.0, 0.0, 0.0);
-    int nPoints = 0;
-
-    std::vector<Point3> points;
-    std::vector<std::vector<Point3>> clusters;
-
-    for (vtkIdType i = begin; i < table->GetNumberOfRows(); i++) {
-        Point3 vPoint = Point3(
-            (table->GetValue(i, 1)).ToDouble(),
-            (table->GetValue(i, 2)).ToDouble(),
-            (table->GetValue(i, 3)).ToDouble()
-        );
-        
-        if (Point3::dist(current, vPoint) > 0.75) {
-            clusters.push_back(points);
-            points.clear();
-
-            average.scale(1.0 / nPoints);
-            averagePoints.push_back(average);
-            double avgPoint[] = { average.x, average.y, average.z };
-            aggregatedPositions.InsertNextPoint(avgPoint);
-            point_index++;
-
-            current = Point3(vPoint.x, vPoint.y, vPoint.z);
-            average = Point3(0.0, 0.0, 0.0);
-            nPoints = 0; 
+void visibleIndices(std::span<const Rgba> colors, std::vector<uint32_t>& indices) {
+    indices.clear();
+    for (uint32_t i = 0; i < colors.size(); i++) {
+        if (colors[i][3] != 0) {
+            indices.push_back(i);
         }
+    }
+}
 
-        average.add(vPoint);
-        nPoints++;
-        points.push_back(vPoint);
-        mapping[(table->GetValue(i, 0)).ToInt() - 1] = point_index;
+void compactPoints(std::span<const Position> positions, std::span<const Rgba> colors, std::span<const uint32_t> indices,
+    vtkPoints& compactPositions, vtkUnsignedCharArray& compactColors)
+{
+    if (uint32_t largest = indices.empty() ? 0 : ranges::max(indices); !indices.empty() && largest >= std::min(positions.size(), colors.size())) {
+        std::string msg = "Point index " + std::to_string(largest) + " is out of range of " + std::to_string(positions.size())
+            + " positions and " + std::to_string(colors.size()) + " colors.";
+        std::cout << msg << std::endl;
+        throw std::runtime_error{ msg };
     }
 
-    clusters.push_back(points);
-    average.scale(1.0 / nPoints);
-    averagePoints.push_back(average);
+    compactPositions.SetDataTypeToFloat();
+    compactPositions.SetNumberOfPoints(indices.size());
+    compactColors.SetNumberOfComponents(4);
+    compactColors.SetNumberOfTuples(indices.size());
 
-    double avgPoint[] = { average.x, average.y, average.z };
-    aggregatedPositions.InsertNextPoint(avgPoint);
+    auto* positionOut = static_cast<Position*>(compactPositions.GetVoidPointer(0));
+    auto* colorOut = reinterpret_cast<Rgba*>(compactColors.GetPointer(0));
+    for (size_t i = 0; i < indices.size(); i++) {
+        positionOut[i] = positions[indices[i]];
+        colorOut[i] = colors[indices[i]];
+    }
+    compactPositions.Modified();
+    compactColors.Modified();
+}
 
-    // This is the original code
+void loadPositions(vtkPoints& originalPositions, vtkPoints& scatteredPositions, vtkPoints& aggregatedPositions, std::vector<uint32_t>& mapping) {
+    ScopedTimer timer(ProfileStage::Io, "loadPositions");
+    auto fill = [&](const PositionLayoutView& layout) {
+        copyPositions(originalPositions, layout.positions);
+        copyPositions(scatteredPositions, layout.scattered);
+        copyPositions(aggregatedPositions, layout.aggregated);
+        mapping.assign(layout.mapping.begin(), layout.mapping.end());
+    };
 
-    for (std::vector<Point3> cluster : clusters) {
-        for (Point3 cPoint : cluster) {
-            double mPoint[] = { cPoint.x, cPoint.y, cPoint.z };
-            originalPositions.InsertNextPoint(mPoint);
-        }
+    auto path = dataFolder / positionLayoutPath;
+    if (std::filesystem::exists(path)) {
+        MappedPositionLayout layout(path);
+        fill(layout.view());
     }
+    else {
+        std::cout << "File " << path << " doesn't exist, run PreprocessPositions to speed up loading.\n";
+        auto layout = computePositionLayout(dataFolder / "positions/rank_0_positions.txt");
+        fill(layout.view());
+    }
+}
 
-    // This generates random poisson disk patterns (equally spaced points)
-    // That are used to place the point clusters
-    std::vector<std::vector<double>> random_s;
-    std::vector<std::vector<double>> random_t;
-    const double collisionDistance = 0.6;
-    const int n_patterns = 8;
-    for (int p = 0; p < n_patterns; p++) {
-        std::vector<double> ss = { 0.0 };
-        std::vector<double> tt = { 0.0 };
-
-        while (ss.size() < 10) {
-            double s = 2 * ((double)rand() / RAND_MAX) - 1;
-            double t = 2 * ((double)rand() / RAND_MAX) - 1;
-
-            bool hit = false;
-            for (int i = 0; i < ss.size(); i++) {
-                if (sqrt((s - ss[i]) * (s - ss[i]) + (t - tt[i]) * (t - tt[i])) < collisionDistance) {
-                    hit = true;
-                    break;
-                }
-            }
-            if (hit == false) {
-                ss.push_back(s);
-                tt.push_back(t);
-            }
-        }
+std::filesystem::path timestepPath(int timestep, const std::filesystem::path& folder) {
+    return folder / "monitors-bin" / ("timestep" + std::to_string(timestep));
+}
 
-        random_s.push_back(ss);
-        random_t.push_back(tt);
+void prefetchTimestep(int timestep, const std::filesystem::path& folder) {
+    if (timestep < 0 || timestep >= static_cast<int>(dataset().timestepCount)) {
+        return;
     }
+    auto& cache = pageCache();
+    auto file = cache.open(timestepPath(timestep, folder));
+    // A quarter of the cache at most, so prefetching doesn't evict the timestep that is being shown
+    cache.prefetch(file, 0, std::min<uint64_t>(cache.fileSize(file), cache.getCapacity() / 4));
+}
 
+SpatialIndex buildSpatialIndex(vtkPoints& points) {
+    std::vector<SpatialIndex::Point> indexPoints(points.GetNumberOfPoints());
+    parallelFor(indexPoints.size(), [&](size_t i) {
+        points.GetPoint(i, indexPoints[i].data());
+    });
+    return SpatialIndex(std::move(indexPoints));
+}
 
-    // This calculates the point positions
-    for (int i = 0; i < averagePoints.size(); i++) {
-        // First find 4 closest non-cluster points to given points
-        std::vector<Point3> closePoints = findClosestPoints(i, averagePoints);
-        double avgDistance = 0.0;
-        for (Point3 &point : closePoints) {
-            avgDistance += Point3::dist(point, averagePoints[i]);
-        }
-        avgDistance /= closePoints.size();
-
-        // Approximate derivatives using the 4 points by finding tuples whose vectors
-        // have the biggest angle between them
-        int possibilities[4][4] = { {0, 1, 2, 3}, {0, 2, 1, 3}, {0, 3, 1, 2}, {1, 2, 0, 3} };
-        int* best = possibilities[0];
-        double minDot = 1.0;
-        for (int* v : possibilities) {
-            Point3 first = Point3::vector(closePoints[v[0]], closePoints[v[1]]);
-            Point3 second = Point3::vector(closePoints[v[2]], closePoints[v[3]]);
-            double dot = first.x * second.x + first.y * second.y + first.z * second.z;
-            if (abs(dot) < minDot) {
-                best = v;
-                minDot = abs(dot);
+std::vector<Edge> loadEdges(int timestep) {
+    ScopedTimer timer(ProfileStage::Io, "loadEdges");
+    auto step = dataset().snapshotStep(dataset().snapshotOf(timestep));
+    auto path = (dataFolder / "network-bin/rank_0_step_").string() + std::to_string(step) + "_in_network";
+    PagedReader<Edge> reader(path);
+    auto header = reader.count() > 0 ? std::bit_cast<EdgeFileHeader>(reader.read()) : EdgeFileHeader{ 0, 0, 0 };
+    checkEdgeFileHeader(header, path);
+
+    // Edges are sorted by weight, only the heavy ones at the start of the file are read
+    std::vector<Edge> result;
+    std::vector<Edge> edges(4096);
+    for (size_t read = 1; read < reader.count(); read += edges.size()) {
+        edges.resize(std::min(edges.size(), reader.count() - read));
+        reader.read(std::span(edges));
+        for (auto& edge : edges) {
+            if (edge.weight <= 3) {
+                return result;
             }
-        }
-
-        Point3 first = Point3::vector(closePoints[best[0]], closePoints[best[1]]);
-        Point3 second = Point3::vector(closePoints[best[2]], closePoints[best[3]]);
-        Point3 normal = Point3::cross(first, second);
-        normal.normalize();
-
-        Point3 pa = Point3::cross(normal, first);
-        Point3 pb = Point3::cross(normal, pa);
-        pa.normalize();
-        pb.normalize();
-
-        // Generate the points using the calculated normal vector at that point + random patterns
-        // Make it adaptive because why shouldnt I
-        double scale = std::clamp(avgDistance / 2.0, 1.0, 3.0);
-        int pattern = rand() % n_patterns;
-        for (int j = 0; j < random_s[pattern].size(); j++) {
-            double s = random_s[pattern][j];
-            double t = random_t[pattern][j];
-            double mPoint[] = { averagePoints[i].x + scale * (s * pa.x + t * pb.x), averagePoints[i].y + scale * (s * pa.y + t * pb.y), averagePoints[i].z + scale * (s * pa.z + t * pb.z) };
-            scatteredPositions.InsertNextPoint(mPoint);
+            result.push_back(edge);
         }
     }
+    return result;
 }
 
-void loadEdges(vtkMutableDirectedGraph& g, std::vector<uint16_t> map, int timestep) {
-    timestep = timestep / 100 * 100;
-    if (timestep % 100 != 0) {
-        return;
+AttributeTables computeAttributeTables(std::span<const float> table, size_t timestepCount, std::span<const uint32_t> neurons, Range valueRange, int binCount) {
+    ScopedTimer timer(ProfileStage::Histograms, "computeAttributeTables");
+    AttributeTables result;
+    if (timestepCount == 0 || binCount <= 0) {
+        return result;
     }
-    auto path = (dataFolder / "network-bin/rank_0_step_").string() + std::to_string(timestep * 100) + "_in_network";
-    BinaryReader<Edge> reader(path);
 
-    for (unsigned i = 0; i < reader.count(); i++) {
-        Edge edge = reader.read();
-        if (edge.weight <= 3) {
-            break;
+    size_t neuronCount = neurons.empty() ? table.size() / timestepCount : neurons.size();
+    for (auto neuron : neurons) {
+        if (neuron >= table.size() / timestepCount) {
+            std::string msg = "Neuron " + std::to_string(neuron) + " is out of range of the " + std::to_string(table.size() / timestepCount)
+                + " neurons of the table.";
+            std::cout << msg << std::endl;
+            throw std::runtime_error{ msg };
         }
-        g.AddEdge(edge.from, edge.to);
     }
-}
 
-std::pair<float, float> diffMinMax(int timestep, int colorAttribute) {
-    int pointCount = 50000;
-
-    if (timestep == 0) {
-        timestep = 1;
-    }
-
-    auto previousTimestepPath = (dataFolder / "monitors-bin/timestep").string() + std::to_string(timestep - 1);
-    BinaryReader<NeuronProperties> previousReader(previousTimestepPath);
-
-    auto path = (dataFolder / "monitors-bin/timestep").string() + std::to_string(timestep);
-    BinaryReader<NeuronProperties> reader(path);
+    struct Partial {
+        std::vector<float> min;
+        std::vector<float> max;
+        std::vector<double> sum;
+        std::vector<int> bins;
+    };
 
-    float min = INFINITY, max = -INFINITY;
-    for (int i = 0; i < pointCount; i++) {
-        NeuronProperties properties = reader.read();
-        NeuronProperties prevProperties = previousReader.read();
+    unsigned chunkCount = workerCount();
+    std::vector<Partial> partials(chunkCount);
+
+    double lower = valueRange.lower_bound;
+    double upper = valueRange.upper_bound;
+    double binScale = upper > lower ? binCount / (upper - lower) : 0;
+
+    // Every chunk handles a range of neurons, their rows are contiguous in the table
+    parallelChunks(neuronCount, chunkCount, [&](unsigned chunk, size_t begin, size_t end) {
+        auto& partial = partials[chunk];
+        partial.min.assign(timestepCount, INFINITY);
+        partial.max.assign(timestepCount, -INFINITY);
+        partial.sum.assign(timestepCount, 0);
+        partial.bins.assign(timestepCount * binCount, 0);
+
+        for (size_t i = begin; i < end; i++) {
+            size_t neuron = neurons.empty() ? i : neurons[i];
+            auto row = table.subspan(neuron * timestepCount, timestepCount);
+            for (size_t t = 0; t < timestepCount; t++) {
+                float value = row[t];
+                partial.min[t] = std::min(partial.min[t], value);
+                partial.max[t] = std::max(partial.max[t], value);
+                partial.sum[t] += value;
+
+                // Same as numpy.histogram: values out of range are skipped, the last bin includes its upper edge
+                if (value < lower || value > upper) continue;
+                int bin = std::min(static_cast<int>((value - lower) * binScale), binCount - 1);
+                partial.bins[t * binCount + bin]++;
+            }
+        }
+    });
 
-        auto diff = properties.projection(colorAttribute) - prevProperties.projection(colorAttribute);
-        min = std::min(min, diff);
-        max = std::max(max, diff);
+    result.histogram.assign(timestepCount, std::vector<int>(binCount, 0));
+    result.summary.resize(timestepCount);
+    for (size_t t = 0; t < timestepCount; t++) {
+        Statistics stats{ .mean = 0, .sum = 0, .min = INFINITY, .max = -INFINITY };
+        for (auto& partial : partials) {
+            if (partial.sum.empty()) continue;
+            stats.min = std::min<double>(stats.min, partial.min[t]);
+            stats.max = std::max<double>(stats.max, partial.max[t]);
+            stats.sum += partial.sum[t];
+            for (int bin = 0; bin < binCount; bin++) {
+                result.histogram[t][bin] += partial.bins[t * binCount + bin];
+            }
+        }
+        stats.mean = neuronCount > 0 ? stats.sum / neuronCount : 0;
+        result.summary[t] = stats;
     }
-    return { min, max };
+    result.globalStatistics = computeGlobalStatistics(result.summary);
+    return result;
 }
 
-vtkNew<vtkUnsignedCharArray> loadColors(int timestep, int colorAttribute, double mini, double maxi, Range pointFilter, bool derivatives) {
-    if (derivatives && timestep == 0) {
-        timestep = 1;
+AttributeTables cropAttributeTables(AttributeData data, Range dataRange, Range valueRange) {
+    AttributeTables result;
+    result.summary.assign(data.summary.begin(), data.summary.end());
+    result.globalStatistics = data.globalStatistics;
+
+    int binCount = data.histogram.empty() ? 0 : static_cast<int>(data.histogram[0].size());
+    double binWidth = (dataRange.upper_bound - dataRange.lower_bound) / std::max(binCount, 1);
+    int first = 0;
+    int last = binCount;
+    if (binWidth > 0 && binCount > 0) {
+        first = std::clamp(static_cast<int>(std::floor((valueRange.lower_bound - dataRange.lower_bound) / binWidth)), 0, binCount - 1);
+        last = std::clamp(static_cast<int>(std::ceil((valueRange.upper_bound - dataRange.lower_bound) / binWidth)), first + 1, binCount);
     }
 
-    const int pointCount = 50000;
-    auto path = (dataFolder / "monitors-bin/timestep").string() + std::to_string(timestep);
-    
-    BinaryReader<NeuronProperties> reader(path);
-    if (reader.count() < pointCount) {
-        std::cout << "File:\"" << path << "\" is too small.\n";
-        std::cout << sizeof(NeuronProperties) * pointCount << "bytes expected.\n";
+    result.histogram.reserve(data.histogram.size());
+    for (auto& bins : data.histogram) {
+        result.histogram.emplace_back(bins.begin() + first, bins.begin() + last);
     }
+    return result;
+}
 
-    vtkNew<vtkUnsignedCharArray> colors;
-    colors->SetNumberOfComponents(4);
-    
-    ColorMixer colorMixer(QColor::fromRgbF(0, 0, 1), QColor::fromRgbF(0.7, 0.7, 0.7), QColor::fromRgbF(1, 0, 0), 0.5);
+namespace {
 
-    if (!derivatives) {
-        for (int i = 0; i < pointCount; i++) {
-            NeuronProperties neuron = reader.read();
+    // Colors of the values normalized to [mini, maxi], neurons outside of `pointFilter` are transparent
+    vtkNew<vtkUnsignedCharArray> mapColors(std::span<const float> values, double mini, double maxi, Range pointFilter, bool clampValues) {
+        vtkNew<vtkUnsignedCharArray> colors;
+        colors->SetNumberOfComponents(4);
+        colors->SetNumberOfTuples(values.size());
 
-            //if (i == 0 || map[i] == map[i - 1]) continue;
+        ColorMixer colorMixer(QColor::fromRgbF(0, 0, 1), QColor::fromRgbF(0.7, 0.7, 0.7), QColor::fromRgbF(1, 0, 0), 0.5);
 
-            auto val = (neuron.projection(colorAttribute) - mini) / (maxi - mini);
-            val = std::clamp(val, 0.0, 1.0);
+        for (size_t i = 0; i < values.size(); i++) {
+            double val = (values[i] - mini) / (maxi - mini);
+            if (clampValues) {
+                val = std::clamp(val, 0.0, 1.0);
+            }
             QColor color = colorMixer.getColor(val);
 
             unsigned char alpha = pointFilter.inRange(val) ? 255 : 0;
 
             std::array<unsigned char, 4> colorBytes = { (unsigned char)color.red(), (unsigned char)color.green(), (unsigned char)color.blue(), alpha };
 
-            colors->InsertNextTypedTuple(colorBytes.data());
+            colors->SetTypedTuple(i, colorBytes.data());
         }
+        return colors;
     }
-    else {
-        auto previousTimestepPath = (dataFolder / "monitors-bin/timestep").string() + std::to_string(timestep - 1);
-        BinaryReader<NeuronProperties> previousReader(previousTimestepPath);
 
-        for (int i = 0; i < pointCount; i++) {
-            NeuronProperties properties = reader.read();
-            NeuronProperties prevProperties = previousReader.read();
+    // Values of `colorAttribute` of all neurons at `timestep` in `folder`
+    void readAttribute(int timestep, int colorAttribute, const std::filesystem::path& folder, std::span<float> values) {
+        auto path = timestepPath(timestep, folder);
+        PagedReader<NeuronProperties> reader(path);
+        if (reader.count() < values.size()) {
+            std::cout << "File:\"" << path << "\" is too small.\n";
+            std::cout << sizeof(NeuronProperties) * values.size() << "bytes expected.\n";
+        }
+        std::vector<NeuronProperties> neurons(values.size());
+        reader.read(neurons);
+        for (size_t i = 0; i < values.size(); i++) {
+            values[i] = neurons[i].projection(colorAttribute);
+        }
+    }
 
-            auto difference = properties.projection(colorAttribute) - prevProperties.projection(colorAttribute);
-            auto val = (difference - mini) / (maxi - mini);
+    // Writes `minuend - subtrahend` and returns the largest absolute difference.
+    // Plain loops over contiguous floats without branches, so the compiler vectorizes them.
+    float differenceKernel(std::span<const float> minuend, std::span<const float> subtrahend, std::span<float> difference) {
+        const size_t count = difference.size();
+        const float* a = minuend.data();
+        const float* b = subtrahend.data();
+        float* d = difference.data();
+        for (size_t i = 0; i < count; i++) {
+            d[i] = a[i] - b[i];
+        }
+        float maxAbs = 0;
+        for (size_t i = 0; i < count; i++) {
+            maxAbs = std::max(maxAbs, std::abs(d[i]));
+        }
+        return maxAbs;
+    }
+}
 
-            QColor color = colorMixer.getColor(val);
+std::pair<float, float> diffMinMax(int timestep, int colorAttribute) {
+    const size_t pointCount = dataset().neuronCount;
 
-            unsigned char alpha = pointFilter.inRange(val) ? 255 : 0;
+    if (timestep == 0) {
+        timestep = 1;
+    }
 
-            std::array<unsigned char, 4> colorBytes = { (unsigned char)color.red(), (unsigned char)color.green(), (unsigned char)color.blue(), alpha };
+    std::vector<float> values(pointCount), previousValues(pointCount);
+    readAttribute(timestep - 1, colorAttribute, dataFolder, previousValues);
+    readAttribute(timestep, colorAttribute, dataFolder, values);
+    differenceKernel(values, previousValues, values);
+
+    auto [min, max] = std::ranges::minmax_element(values);
+    return { *min, *max };
+}
 
-            colors->InsertNextTypedTuple(colorBytes.data());
+vtkNew<vtkUnsignedCharArray> loadColors(int timestep, int colorAttribute, double mini, double maxi, Range pointFilter, bool derivatives,
+    const std::filesystem::path& folder)
+{
+    if (derivatives && timestep == 0) {
+        timestep = 1;
+    }
+
+    const size_t pointCount = dataset().neuronCount;
+    std::vector<float> values(pointCount);
+    std::vector<float> previousValues;
+    {
+        ScopedTimer timer(ProfileStage::Io, "loadColors read");
+        readAttribute(timestep, colorAttribute, folder, values);
+
+        if (derivatives) {
+            previousValues.resize(pointCount);
+            readAttribute(timestep - 1, colorAttribute, folder, previousValues);
         }
+        // Playback and scrubbing usually request the next timestep
+        prefetchTimestep(timestep + 1, folder);
+    }
+
+    ScopedTimer timer(ProfileStage::ColorMapping, "loadColors map");
+    if (derivatives) {
+        differenceKernel(values, previousValues, values);
+    }
+    return mapColors(values, mini, maxi, pointFilter, !derivatives);
+}
+
+DifferenceColors loadDifferenceColors(int timestep, int colorAttribute, const std::filesystem::path& minuend, const std::filesystem::path& subtrahend,
+    Range pointFilter)
+{
+    const size_t pointCount = dataset().neuronCount;
+    std::vector<float> minuendValues(pointCount), subtrahendValues(pointCount);
+    {
+        ScopedTimer timer(ProfileStage::Io, "loadDifferenceColors read");
+        // The second dataset is read by a worker meanwhile
+        std::packaged_task<void()> readSubtrahend([&]() { readAttribute(timestep, colorAttribute, subtrahend, subtrahendValues); });
+        auto subtrahendRead = readSubtrahend.get_future();
+        TaskGroup tasks;
+        tasks.submit([&]() { readSubtrahend(); }, 1);
+        readAttribute(timestep, colorAttribute, minuend, minuendValues);
+        subtrahendRead.get();
+
+        prefetchTimestep(timestep + 1, minuend);
+        prefetchTimestep(timestep + 1, subtrahend);
     }
 
-    return colors;
+    ScopedTimer timer(ProfileStage::ColorMapping, "loadDifferenceColors map");
+    std::vector<float> difference(pointCount);
+    float maxAbs = differenceKernel(minuendValues, subtrahendValues, difference);
+    // Identical datasets are shown in the middle color
+    maxAbs = std::max(maxAbs, std::numeric_limits<float>::min());
+    return { mapColors(difference, -maxAbs, maxAbs, pointFilter, false).Get(), maxAbs };
 }
 
 
@@ -444,18 +465,30 @@ std::vector<std::vector<StoredType>> parseCSV(std::string path) {
     return result;
 }
 
+template std::vector<std::vector<int>> parseCSV<int, ' '>(std::string path);
+template std::vector<std::vector<double>> parseCSV<double, ' '>(std::string path);
 
 
-
-void HistogramDataLoader::ensureLoaded(int colorAttribute) {
-    if (dataState[colorAttribute] == Loaded) {
-        return;
+void HistogramDataLoader::ensureLoaded(int colorAttribute, bool reload) {
+    auto state = dataState[colorAttribute].load();
+    while (true) {
+        if (state == Loaded || (state == Evicted && !reload)) {
+            return;
+        }
+        if (state == Loading) {
+            // Another thread loads or evicts the attribute
+            dataState[colorAttribute].wait(Loading);
+            state = dataState[colorAttribute].load();
+        }
+        else if (dataState[colorAttribute].compare_exchange_weak(state, Loading)) {
+            break;
+        }
     }
 
-    auto unloaded = Unloaded;
-    if (dataState[colorAttribute].compare_exchange_strong(unloaded, Loading)) {
+    try {
+        ScopedTimer timer(ProfileStage::Io, "HistogramDataLoader load");
         histogramData[colorAttribute] = parseCSV<int, ' '>((dataFolder / "monitors-hist-real/").string() + attributeToString(colorAttribute));
-        
+    
         auto statistics = parseCSV<double, ' '>((dataFolder / "monitors-histogram/").string() + attributeToString(colorAttribute));
         summaryData[colorAttribute].reserve(statistics.size());
         ranges::transform(statistics, std::back_inserter(summaryData[colorAttribute]),
@@ -463,17 +496,32 @@ void HistogramDataLoader::ensureLoaded(int colorAttribute) {
 
         auto globalStats = computeGlobalStatistics(summaryData[colorAttribute]);
         globalStatistics[colorAttribute] = globalStats;
-
-        dataState[colorAttribute] = Loaded;
+    }
+    catch (...) {
+        // Back to Unloaded, so waiters and later requests try again instead of waiting forever
+        histogramData[colorAttribute] = {};
+        summaryData[colorAttribute] = {};
+        dataState[colorAttribute] = Unloaded;
         dataState[colorAttribute].notify_all();
+        throw;
     }
-    else {
-        dataState[colorAttribute].wait(Loading);
+
+    dataState[colorAttribute] = Loaded;
+    dataState[colorAttribute].notify_all();
+
+    if (attributeLoaded) {
+        attributeLoaded(colorAttribute);
     }
 }
 
+void HistogramDataLoader::request(int colorAttribute) {
+    tasks.prioritize(loadTasks[colorAttribute], 1);
+}
+
 AttributeData HistogramDataLoader::getAttributeData(int colorAttribute) {
+    // Loads on this thread unless a worker already started
     ensureLoaded(colorAttribute);
+    lastUse[colorAttribute] = ++useCounter;
     assert(histogramData[colorAttribute].size() > 0);
     return { 
         .histogram = histogramData[colorAttribute], 
@@ -482,20 +530,54 @@ AttributeData HistogramDataLoader::getAttributeData(int colorAttribute) {
     };
 }
 
-HistogramDataLoader::HistogramDataLoader() {
-    backgroundThread = std::thread([this]() {
-        for (int i = 0; i < 12; i++) {
-            if (!continueBackground) {
-                return;
-            }
-            ensureLoaded(i);
+size_t HistogramDataLoader::attributeBytes(int colorAttribute) const {
+    size_t result = histogramData[colorAttribute].capacity() * sizeof(std::vector<int>) + summaryData[colorAttribute].capacity() * sizeof(Statistics);
+    for (auto& bins : histogramData[colorAttribute]) {
+        result += bins.capacity() * sizeof(int);
+    }
+    return result;
+}
+
+size_t HistogramDataLoader::memoryBytes() const {
+    size_t result = 0;
+    for (int i = 0; i < NeuronProperties::attributeCount; i++) {
+        if (dataState[i] == Loaded) {
+            result += attributeBytes(i);
         }
-    });
+    }
+    return result;
 }
 
-HistogramDataLoader::~HistogramDataLoader() {
-    continueBackground = false;
-    if (backgroundThread.joinable()) {
-        backgroundThread.join();
+size_t HistogramDataLoader::evict(size_t bytes, int keep) {
+    std::array<int, NeuronProperties::attributeCount> order;
+    std::iota(order.begin(), order.end(), 0);
+    ranges::sort(order, {}, [&](int i) { return lastUse[i].load(); });
+
+    size_t released = 0;
+    for (int i : order) {
+        if (released >= bytes) break;
+        // Loading keeps other threads from reading or reloading the tables while they are cleared
+        auto loaded = Loaded;
+        if (i == keep || !dataState[i].compare_exchange_strong(loaded, Loading)) continue;
+
+        released += attributeBytes(i);
+        histogramData[i] = {};
+        summaryData[i] = {};
+
+        dataState[i] = Evicted;
+        dataState[i].notify_all();
+    }
+    return released;
+}
+
+HistogramDataLoader::HistogramDataLoader(std::function<void(int colorAttribute)> attributeLoaded) :
+    attributeLoaded(std::move(attributeLoaded))
+{
+    for (int i = 0; i < NeuronProperties::attributeCount; i++) {
+        loadTasks[i] = tasks.submit([this, i]() { ensureLoaded(i, false); });
     }
+}
+
+HistogramDataLoader::~HistogramDataLoader() {
+    tasks.cancelAndWait();
 };
@@ -3,7 +3,7 @@
 #include <vtkPoints.h>
 #include <vtkNew.h>
 #include <vtkUnsignedCharArray.h>
-#include <vtkMutableDirectedGraph.h>
+#include <vtkSmartPointer.h>
 
 #include <numeric>
 #include <atomic>
@@ -11,8 +11,15 @@
 #include <array>
 #include <thread>
 #include <span>
+#include <functional>
+#include <filesystem>
 
 #include "visUtility.hpp"
+#include "spatialIndex.hpp"
+#include "positionLayout.hpp"
+#include "workerPool.hpp"
+#include "neuronProperties.hpp"
+#include "edge.hpp"
 
 struct Range {
     double lower_bound;
@@ -34,35 +41,129 @@ struct AttributeData {
     Statistics globalStatistics;
 };
 
+// Owned histogram and statistics tables, e.g. of a selected subset of neurons
+struct AttributeTables {
+    std::vector<std::vector<int>> histogram;
+    std::vector<Statistics> summary;
+    Statistics globalStatistics{};
+
+    bool empty() const { return summary.empty(); }
+
+    size_t memoryBytes() const {
+        size_t result = histogram.capacity() * sizeof(std::vector<int>) + summary.capacity() * sizeof(Statistics);
+        for (auto& bins : histogram) {
+            result += bins.capacity() * sizeof(int);
+        }
+        return result;
+    }
+
+    AttributeData view() {
+        return { .histogram = histogram, .summary = summary, .globalStatistics = globalStatistics };
+    }
+};
+
+// Scans the neuron-major table (see NeuronHistoryStore) in parallel and computes per timestep statistics
+// and histograms with `binCount` bins over `valueRange` of `neurons`, all neurons are used when it is empty.
+AttributeTables computeAttributeTables(std::span<const float> table, size_t timestepCount, std::span<const uint32_t> neurons, Range valueRange, int binCount);
+
+// Coarse histograms of `valueRange` made of the bins of `data` that overlap it, `dataRange` is the range of all bins of `data`
+AttributeTables cropAttributeTables(AttributeData data, Range dataRange, Range valueRange);
+
+// monitors-bin file of `timestep`, read through the page cache
+std::filesystem::path timestepPath(int timestep, const std::filesystem::path& folder = dataFolder);
+
+// Queues the monitors of `timestep` for reading on idle workers
+void prefetchTimestep(int timestep, const std::filesystem::path& folder = dataFolder);
 
 std::pair<float, float> diffMinMax(int timestep, int colorAttribute);
 
-void loadPositions(vtkPoints& originalPositions, vtkPoints& scatteredPositions, vtkPoints& aggregatedPositions, std::vector<uint16_t>& mapping);
+void loadPositions(vtkPoints& originalPositions, vtkPoints& scatteredPositions, vtkPoints& aggregatedPositions, std::vector<uint32_t>& mapping);
+
+SpatialIndex buildSpatialIndex(vtkPoints& points);
+
+void copyPositions(vtkPoints& points, std::span<const Position> positions);
+
+// View of float points stored in vtkPoints
+std::span<const Position> positionSpan(vtkPoints& points);
 
-vtkNew<vtkUnsignedCharArray> loadColors(int timestep, int colorAttribute, double mini, double maxi, Range pointFilter, bool derivatives);
+// View of RGBA colors stored in vtkUnsignedCharArray
+std::span<const Rgba> colorSpan(vtkUnsignedCharArray& colors);
 
-void loadEdges(vtkMutableDirectedGraph& g, std::vector<uint16_t> map, int timestep);
+// Indices of the points that aren't hidden by the point filter, i.e. whose alpha isn't 0
+void visibleIndices(std::span<const Rgba> colors, std::vector<uint32_t>& indices);
+
+// Gathers the positions and colors of `indices`, so filtered points aren't uploaded and rasterized at all.
+// Throws if an index is out of range of `positions` or `colors`.
+void compactPoints(std::span<const Position> positions, std::span<const Rgba> colors, std::span<const uint32_t> indices,
+    vtkPoints& compactPositions, vtkUnsignedCharArray& compactColors);
+
+// Colors of the neurons of the dataset in `folder`, which has to have the same positions as the one in dataFolder
+vtkNew<vtkUnsignedCharArray> loadColors(int timestep, int colorAttribute, double mini, double maxi, Range pointFilter, bool derivatives,
+    const std::filesystem::path& folder = dataFolder);
+
+struct DifferenceColors {
+    vtkSmartPointer<vtkUnsignedCharArray> colors;
+    // Differences are colored over [-maxDifference, maxDifference]
+    float maxDifference;
+};
+
+// Per neuron difference `minuend - subtrahend` of two datasets with the same positions, colored like derivatives.
+// Both datasets are read concurrently.
+DifferenceColors loadDifferenceColors(int timestep, int colorAttribute, const std::filesystem::path& minuend, const std::filesystem::path& subtrahend,
+    Range pointFilter);
+
+// Edges of the network snapshot shown at `timestep` that are drawn, ids are position clusters
+std::vector<Edge> loadEdges(int timestep);
 
 std::string attributeToString(int attribute);
 
+// Rows of numbers separated by `deliminer`, lines starting with '#' are skipped.
+// Instantiated for <int, ' '> and <double, ' '>.
+template<typename StoredType, char deliminer>
+std::vector<std::vector<StoredType>> parseCSV(std::string path);
 
+
+// Loads the histograms and statistics of all attributes in parallel on the shared worker pool.
+// Requested attributes are moved to the front of the queue or loaded right away by the requesting thread.
 class HistogramDataLoader {
-        enum dataState { Unloaded, Loading, Loaded };
+        // Evicted attributes are only loaded again on request, not by the queued background load
+        enum dataState { Unloaded, Loading, Loaded, Evicted };
+
+        std::array<std::atomic<dataState>, NeuronProperties::attributeCount> dataState;
+        std::array<std::vector<std::vector<int>>, NeuronProperties::attributeCount> histogramData;
+        std::array<std::vector<Statistics>, NeuronProperties::attributeCount> summaryData;
+        std::array<Statistics, NeuronProperties::attributeCount> globalStatistics;
 
-        std::array<std::atomic<dataState>, 12> dataState;
-        std::array<std::vector<std::vector<int>>, 12> histogramData;
-        std::array<std::vector<Statistics>, 12> summaryData;
-        std::array<Statistics, 12> globalStatistics;
+        // Called from the loading thread whenever an attribute finished loading
+        std::function<void(int colorAttribute)> attributeLoaded;
+        std::array<uint64_t, NeuronProperties::attributeCount> loadTasks;
+        TaskGroup tasks;
 
-        std::atomic<bool> continueBackground = true;
-        std::thread backgroundThread;
+        // Order of the last getAttributeData call of every attribute, the least recently used are evicted first
+        std::array<std::atomic<uint64_t>, NeuronProperties::attributeCount> lastUse{};
+        std::atomic<uint64_t> useCounter = 0;
 
-        void ensureLoaded(int colorAttribute);
+        void ensureLoaded(int colorAttribute, bool reload = true);
+        size_t attributeBytes(int colorAttribute) const;
 
     public:
         AttributeData getAttributeData(int colorAttribute);
 
-        HistogramDataLoader();
+        // Moves the attribute to the front of the loading queue without waiting for it
+        void request(int colorAttribute);
+
+        bool isLoaded(int colorAttribute) const {
+            return dataState[colorAttribute] == Loaded;
+        }
+
+        // Bytes of the loaded tables
+        size_t memoryBytes() const;
+
+        // Unloads least recently used attributes other than `keep` until about `bytes` bytes are released, returns the released bytes.
+        // Data returned by getAttributeData for the unloaded attributes becomes invalid, they are loaded again on the next request.
+        size_t evict(size_t bytes, int keep);
+
+        HistogramDataLoader(std::function<void(int colorAttribute)> attributeLoaded = {});
         
         ~HistogramDataLoader();
         // Disable copying and moving
@@ -274,4 +274,12 @@ std::array<QColor, 256> magmaColorMap {
     rgb (0.987387, 0.984288, 0.742002),
     rgb (0.987053, 0.991438, 0.749504)
 };
-    
\ No newline at end of file
+    
+
+std::array<QRgb, 256> magmaRgbMap = [] {
+    std::array<QRgb, 256> result;
+    for (size_t i = 0; i < result.size(); i++) {
+        result[i] = magmaColorMap[i].rgb();
+    }
+    return result;
+}();
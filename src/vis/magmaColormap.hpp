@@ -6,6 +6,8 @@
 #include <array>
 
 extern std::array<QColor, 256> magmaColorMap;
+// Same colors for writing QImage pixels directly
+extern std::array<QRgb, 256> magmaRgbMap;
 
 // i in range (0 , 1)
 constexpr QColor getMagmaColor(double i) {
@@ -1,10 +1,18 @@
 #include <QApplication>
 #include <QMainWindow>
+#include <QScreen>
 #include <QVTKOpenGLNativeWidget.h>
 
+#include <chrono>
+#include <optional>
+#include <string_view>
+
 #include "visUtility.hpp"
 #include "visualisation.hpp"
 #include "popupWidget.hpp"
+#include "traceRecorder.hpp"
+#include "memoryRegistry.hpp"
+#include "pageCache.hpp"
 
 #include "ui_mainWindow.h"
 
@@ -37,7 +45,7 @@ namespace { //anonymous namespace
 
     class Application {
     public:
-        Application(int argc, char** argv) {
+        Application(int argc, char** argv, ComparisonOptions comparison, ProgressiveOptions progressive) {
 
             QSurfaceFormat::setDefaultFormat(QVTKOpenGLNativeWidget::defaultFormat());
             application.init(argc, argv);
@@ -47,13 +55,18 @@ namespace { //anonymous namespace
             mainUI.init();
             mainUI->setupUi(mainWindow.ptr());
 
+            auto* neuronHistoryPopup = new NeuronHistoryPopUp(mainWindow.ptr());
+
             visualisation.init(Widgets{ mainUI->histogram, mainUI->histogramSlider, mainUI->histogramSliderLabel,
                 mainUI->rangeSlider,  mainUI->minValLabel, mainUI->maxValLabel, 
-                mainUI->neuronGlobalPropertiesLabel, mainUI->neuronCurrentTimestepPropertiesLabel });
+                mainUI->neuronGlobalPropertiesLabel, mainUI->neuronCurrentTimestepPropertiesLabel, neuronHistoryPopup, mainUI->comboBox });
+            visualisation->comparison.options = std::move(comparison);
+            visualisation->progressive = progressive;
             visualisation->loadData();
 
             visualisationWidget.init();
             visualisationWidget->setRenderWindow(visualisation->context.renderWindow);
+            visualisation->initInteraction(visualisationWidget->interactor());
             mainUI->mainVisDock->addWidget(visualisationWidget.ptr());
             
             mainUI->histogram->setFocusPolicy(Qt::ClickFocus);
@@ -72,28 +85,38 @@ namespace { //anonymous namespace
             for (auto name : attributeNames) {
                 mainUI->comboBox->addItem(name);
             }
+            visualisation->updateAttributeProgress();
 
             // Remove title bars
             mainUI->leftDockWidget->setTitleBarWidget(new QWidget());
             mainUI->bottomDockWidget->setTitleBarWidget(new QWidget());
             
             mainUI->bottomDockWidget->setFixedHeight(200);
+            // Simulation step of the last timestep at the end of the slider
+            mainUI->label_3->setText(QString::number(dataset().simulationStep(dataset().timestepCount - 1)));
 
             QObject::connect(mainUI->comboBox, &QComboBox::currentIndexChanged, visualisation.ptr(), &Visualisation::changeColorAttribute);
+            QObject::connect(mainUI->comboBox, &QComboBox::highlighted, visualisation.ptr(), &Visualisation::prefetchAttribute);
             QObject::connect(mainUI->comboBox_2, &QComboBox::currentIndexChanged, visualisation.ptr(), &Visualisation::changeDrawMode);
             QObject::connect(mainUI->showEdgesCheckBox, &QCheckBox::stateChanged, visualisation.ptr(), &Visualisation::showEdges);
+            QObject::connect(mainUI->edgeClustersCheckBox, &QCheckBox::stateChanged, visualisation.ptr(), &Visualisation::showEdgeClusters);
             QObject::connect(mainUI->histogram, &HistogramWidget::histogramCursorMoved, visualisation.ptr(), &Visualisation::changeTimestep);
             QObject::connect(mainUI->histogramSlider, &HistogramSliderWidget::histogramCursorMoved, visualisation.ptr(), &Visualisation::changeTimestepRange);
             QObject::connect(mainUI->logScaleCheckbox, &QCheckBox::stateChanged, visualisation.ptr(), &Visualisation::logCheckboxChange);
             QObject::connect(mainUI->rangeSlider, &RangeSliderWidget::valueChange, visualisation.ptr(), &Visualisation::setPointFilter);
             QObject::connect(mainUI->pointSizeSlider, &QSlider::valueChanged, visualisation.ptr(), &Visualisation::changePointSize);
             QObject::connect(mainUI->scatterPointsCheckBox, &QCheckBox::stateChanged, visualisation.ptr(), &Visualisation::setPointScattering);
+            QObject::connect(mainUI->levelOfDetailCheckBox, &QCheckBox::stateChanged, visualisation.ptr(), &Visualisation::setLevelOfDetail);
             QObject::connect(mainUI->showDerivativesCheckBox, &QCheckBox::stateChanged, visualisation.ptr(), &Visualisation::showDerivatives);
         }
 
         int run() {
             mainWindow->show();
 
+            // Updates of the scene are coalesced to the refresh rate of the screen
+            if (auto* screen = mainWindow->screen(); screen && screen->refreshRate() > 0) {
+                visualisation->frameInterval = std::chrono::milliseconds(static_cast<int>(1000 / screen->refreshRate()));
+            }
             visualisation->firstRender();
             return application->exec();
         }
@@ -111,6 +134,58 @@ namespace { //anonymous namespace
 
 int main(int argc, char** argv) {
     setCurrentDirectory();
-    Application app(argc, argv);
-    return app.run();
+    // "--data <folder>" shows another dataset than data/viz-calcium
+    parseDataFolder(argc, argv);
+
+    // "--trace <file>" records the session and writes it as a Chrome trace on exit,
+    // "--memory-budget <MiB>" limits the memory held by caches,
+    // "--page-cache <MiB>" limits the pages of monitors and network snapshots kept in memory,
+    // "--compare <folder>" (up to twice) shows other datasets side by side, with "--difference" the difference to the first one instead,
+    // "--progressive <ms>" draws a proxy of the clusters with the "--proxy-edges <count>" heaviest edges until the view was idle that long
+    std::optional<std::filesystem::path> tracePath;
+    size_t memoryBudget = 4096;
+    size_t pageCacheSize = 256;
+    ComparisonOptions comparison;
+    ProgressiveOptions progressive;
+    auto next = [&](int& i) -> const char* {
+        if (i + 1 >= argc) {
+            std::cout << "Missing value of " << argv[i] << std::endl;
+            throw std::runtime_error("Invalid argument");
+        }
+        return argv[++i];
+    };
+    for (int i = 1; i < argc; i++) {
+        std::string_view name = argv[i];
+        if (name == "--difference") comparison.difference = true;
+        else if (name == "--trace") tracePath = next(i);
+        else if (name == "--memory-budget") memoryBudget = std::stoull(next(i));
+        else if (name == "--page-cache") pageCacheSize = std::stoull(next(i));
+        else if (name == "--compare") comparison.folders.push_back(next(i));
+        else if (name == "--progressive") progressive.refineDelay = std::chrono::milliseconds(std::stoull(next(i)));
+        else if (name == "--proxy-edges") progressive.edgeCount = std::stoull(next(i));
+        else {
+            std::cout << "Unknown option " << name << std::endl;
+            throw std::runtime_error("Invalid argument");
+        }
+    }
+    if (comparison.folders.size() > 2 || (comparison.difference && comparison.folders.size() != 1)) {
+        std::cout << "Up to two datasets can be compared, --difference needs exactly one" << std::endl;
+        throw std::runtime_error("Invalid argument");
+    }
+    memoryRegistry().setBudget(memoryBudget << 20);
+    pageCache().setCapacity(pageCacheSize << 20);
+    // Registered first, so pages are released before any other cache
+    MemoryRegistration pageCacheMemory("page cache", []() { return pageCache().memoryBytes(); },
+        [](size_t bytes) { return pageCache().evict(bytes); });
+    if (tracePath) {
+        traceRecorder().enable();
+    }
+
+    Application app(argc, argv, std::move(comparison), progressive);
+    int result = app.run();
+
+    if (tracePath) {
+        traceRecorder().write(*tracePath);
+    }
+    return result;
 }
\ No newline at end of file
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Subsystems register how many bytes they hold, caches also register how to release memory.
+// File-backed mappings are listed but don't count against the budget, the OS can drop their pages at any time.
+// Callbacks are called with the registry locked and must not use the registry themselves.
+class MemoryRegistry {
+public:
+    using Id = uint64_t;
+    // Returns the resident bytes
+    using BytesCallback = std::function<size_t()>;
+    // Releases about `bytes` bytes, returns how many were released
+    using EvictCallback = std::function<size_t(size_t bytes)>;
+
+    struct Usage {
+        std::string name;
+        size_t bytes;
+        bool fileBacked;
+    };
+
+private:
+    struct Entry {
+        std::string name;
+        BytesCallback bytes;
+        EvictCallback evict;
+        bool fileBacked;
+    };
+
+    mutable std::mutex mutex;
+    std::map<Id, Entry> entries;
+    Id nextId = 0;
+    size_t budget = std::numeric_limits<size_t>::max();
+
+    size_t totalLocked() const {
+        size_t result = 0;
+        for (auto& [id, entry] : entries) {
+            if (!entry.fileBacked) result += entry.bytes();
+        }
+        return result;
+    }
+
+public:
+    Id add(std::string name, BytesCallback bytes, EvictCallback evict = {}, bool fileBacked = false) {
+        std::lock_guard lock(mutex);
+        entries.emplace(nextId, Entry{ std::move(name), std::move(bytes), std::move(evict), fileBacked });
+        return nextId++;
+    }
+
+    void remove(Id id) {
+        std::lock_guard lock(mutex);
+        entries.erase(id);
+    }
+
+    void setBudget(size_t bytes) {
+        std::lock_guard lock(mutex);
+        budget = bytes;
+    }
+
+    size_t getBudget() const {
+        std::lock_guard lock(mutex);
+        return budget;
+    }
+
+    // Bytes counted against the budget
+    size_t total() const {
+        std::lock_guard lock(mutex);
+        return totalLocked();
+    }
+
+    std::vector<Usage> usage() const {
+        std::lock_guard lock(mutex);
+        std::vector<Usage> result;
+        for (auto& [id, entry] : entries) {
+            result.push_back({ entry.name, entry.bytes(), entry.fileBacked });
+        }
+        return result;
+    }
+
+    // Asks caches to release memory, in registration order, until the total fits the budget. Returns the released bytes.
+    size_t enforceBudget() {
+        std::lock_guard lock(mutex);
+        size_t total = totalLocked();
+        size_t released = 0;
+        for (auto& [id, entry] : entries) {
+            if (total <= budget) break;
+            if (!entry.evict) continue;
+            size_t freed = std::min(entry.evict(total - budget), total);
+            total -= freed;
+            released += freed;
+        }
+        return released;
+    }
+
+    // One line per subsystem in MiB and the total against the budget
+    std::string report() const {
+        auto mib = [](size_t bytes) { return static_cast<double>(bytes) / (1 << 20); };
+        std::string result = "memory [MiB]\n";
+        size_t total = 0;
+        for (auto& usage : this->usage()) {
+            result += std::format("{:<24} {:>10.1f}{}\n", usage.name, mib(usage.bytes), usage.fileBacked ? " mapped" : "");
+            if (!usage.fileBacked) total += usage.bytes;
+        }
+        size_t limit = getBudget();
+        if (limit == std::numeric_limits<size_t>::max()) {
+            result += std::format("{:<24} {:>10.1f}\n", "total", mib(total));
+        }
+        else {
+            result += std::format("{:<24} {:>10.1f} of {:.0f}\n", "total", mib(total), mib(limit));
+        }
+        return result;
+    }
+};
+
+inline MemoryRegistry& memoryRegistry() {
+    static MemoryRegistry registry;
+    return registry;
+}
+
+// Registration that is removed again when the owner is destroyed, declare it after the memory it reports
+class MemoryRegistration {
+    MemoryRegistry::Id id;
+
+public:
+    MemoryRegistration(std::string name, MemoryRegistry::BytesCallback bytes, MemoryRegistry::EvictCallback evict = {}, bool fileBacked = false) :
+        id(memoryRegistry().add(std::move(name), std::move(bytes), std::move(evict), fileBacked)) { }
+
+    ~MemoryRegistration() {
+        memoryRegistry().remove(id);
+    }
+
+    MemoryRegistration(const MemoryRegistration&) = delete;
+    MemoryRegistration& operator=(const MemoryRegistration&) = delete;
+};
@@ -0,0 +1,285 @@
+#include "pointOctree.hpp"
+
+#include <vtkCamera.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#include "utility.hpp"
+
+LodCamera LodCamera::fromRenderer(vtkRenderer& renderer) {
+    LodCamera result;
+    vtkCamera* camera = renderer.GetActiveCamera();
+
+    std::array<double, 24> planes;
+    camera->GetFrustumPlanes(renderer.GetTiledAspectRatio(), planes.data());
+    for (int i = 0; i < 6; i++) {
+        double* plane = planes.data() + 4 * i;
+        double length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        for (int j = 0; j < 4; j++) {
+            result.planes[i][j] = plane[j] / length;
+        }
+    }
+
+    camera->GetPosition(result.position.data());
+    result.parallelProjection = camera->GetParallelProjection();
+
+    double viewportHeight = std::max(1, renderer.GetSize()[1]);
+    if (result.parallelProjection) {
+        result.pixelScale = viewportHeight / 2 / camera->GetParallelScale();
+    }
+    else {
+        double halfAngle = camera->GetViewAngle() / 2 * std::numbers::pi / 180;
+        result.pixelScale = viewportHeight / 2 / std::tan(halfAngle);
+    }
+    return result;
+}
+
+void PointOctree::splitOctants(uint32_t begin, uint32_t end, Position center, std::array<uint32_t, 9>& bounds) {
+    auto first = order.begin() + begin;
+    auto last = order.begin() + end;
+    auto below = [&](int axis) {
+        return [&, axis](uint32_t index) { return points[index][axis] < center[axis]; };
+    };
+
+    // Octant index is x + 2y + 4z, so partition by z first, then y, then x
+    auto zSplit = std::partition(first, last, below(2));
+    std::array<decltype(first), 5> ySplits{ first, std::partition(first, zSplit, below(1)), zSplit, std::partition(zSplit, last, below(1)), last };
+
+    bounds[0] = begin;
+    for (int half = 0; half < 4; half++) {
+        auto xSplit = std::partition(ySplits[half], ySplits[half + 1], below(0));
+        bounds[2 * half + 1] = static_cast<uint32_t>(xSplit - order.begin());
+        bounds[2 * half + 2] = static_cast<uint32_t>(ySplits[half + 1] - order.begin());
+    }
+}
+
+void PointOctree::buildNode(std::vector<Node>& output, int index, uint32_t begin, uint32_t end, Position center, float halfSize, int depth) {
+    Node node{ .center = center, .halfSize = halfSize, .centroid = {}, .begin = begin, .end = end };
+
+    std::array<double, 3> sum{};
+    for (uint32_t i = begin; i < end; i++) {
+        for (int axis = 0; axis < 3; axis++) {
+            sum[axis] += points[order[i]][axis];
+        }
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        node.centroid[axis] = static_cast<float>(sum[axis] / std::max(1u, end - begin));
+    }
+    output[index] = node;
+
+    if (end - begin <= static_cast<uint32_t>(leafSize) || depth >= maxDepth) {
+        return;
+    }
+
+    std::array<uint32_t, 9> bounds;
+    splitOctants(begin, end, center, bounds);
+
+    // Children of one node are stored next to each other, their subtrees follow. The slots are reserved first and
+    // every child appends its own subtree, so nodes are never copied.
+    int firstChild = static_cast<int>(output.size());
+    int childCount = 0;
+    for (int octant = 0; octant < 8; octant++) {
+        childCount += bounds[octant + 1] > bounds[octant];
+    }
+    output.resize(output.size() + childCount);
+    output[index].firstChild = firstChild;
+    output[index].childCount = static_cast<uint8_t>(childCount);
+
+    int slot = firstChild;
+    for (int octant = 0; octant < 8; octant++) {
+        if (bounds[octant + 1] == bounds[octant]) continue;
+
+        float childHalf = halfSize / 2;
+        Position childCenter{
+            center[0] + (octant & 1 ? childHalf : -childHalf),
+            center[1] + (octant & 2 ? childHalf : -childHalf),
+            center[2] + (octant & 4 ? childHalf : -childHalf),
+        };
+        buildNode(output, slot, bounds[octant], bounds[octant + 1], childCenter, childHalf, depth + 1);
+        slot++;
+    }
+}
+
+void PointOctree::build(std::span<const Position> newPoints) {
+    points = newPoints;
+    nodes.clear();
+    order.resize(points.size());
+    for (uint32_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    if (points.empty()) {
+        return;
+    }
+
+    Position min = points[0];
+    Position max = points[0];
+    for (auto& p : points) {
+        for (int axis = 0; axis < 3; axis++) {
+            min[axis] = std::min(min[axis], p[axis]);
+            max[axis] = std::max(max[axis], p[axis]);
+        }
+    }
+    Position center;
+    float halfSize = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        center[axis] = (min[axis] + max[axis]) / 2;
+        halfSize = std::max(halfSize, (max[axis] - min[axis]) / 2);
+    }
+    halfSize = halfSize * 1.001f + 1e-3f;
+
+    uint32_t count = static_cast<uint32_t>(points.size());
+    if (count <= static_cast<uint32_t>(leafSize)) {
+        nodes.resize(1);
+        buildNode(nodes, 0, 0, count, center, halfSize, 0);
+        return;
+    }
+
+    // The root is split here and its octants are built in parallel, each into its own vector that is appended once
+    std::array<uint32_t, 9> bounds;
+    splitOctants(0, count, center, bounds);
+
+    std::array<std::vector<Node>, 8> subtrees;
+    parallelChunks(8, 8, [&](unsigned octant, size_t, size_t) {
+        if (bounds[octant + 1] == bounds[octant]) return;
+        float childHalf = halfSize / 2;
+        Position childCenter{
+            center[0] + (octant & 1 ? childHalf : -childHalf),
+            center[1] + (octant & 2 ? childHalf : -childHalf),
+            center[2] + (octant & 4 ? childHalf : -childHalf),
+        };
+        subtrees[octant].resize(1);
+        buildNode(subtrees[octant], 0, bounds[octant], bounds[octant + 1], childCenter, childHalf, 1);
+    });
+
+    int childCount = 0;
+    for (auto& subtree : subtrees) {
+        childCount += !subtree.empty();
+    }
+
+    std::array<double, 3> sum{};
+    for (auto& subtree : subtrees) {
+        if (subtree.empty()) continue;
+        for (int axis = 0; axis < 3; axis++) {
+            sum[axis] += static_cast<double>(subtree[0].centroid[axis]) * (subtree[0].end - subtree[0].begin);
+        }
+    }
+    Position centroid{ static_cast<float>(sum[0] / count), static_cast<float>(sum[1] / count), static_cast<float>(sum[2] / count) };
+
+    nodes.push_back(Node{ .center = center, .halfSize = halfSize, .centroid = centroid, .begin = 0, .end = count,
+        .firstChild = 1, .childCount = static_cast<uint8_t>(childCount) });
+    nodes.resize(1 + childCount);
+
+    int slot = 1;
+    for (auto& subtree : subtrees) {
+        if (subtree.empty()) continue;
+        int offset = static_cast<int>(nodes.size()) - 1;
+        nodes[slot] = subtree[0];
+        if (nodes[slot].firstChild != -1) nodes[slot].firstChild += offset;
+        for (size_t i = 1; i < subtree.size(); i++) {
+            if (subtree[i].firstChild != -1) subtree[i].firstChild += offset;
+            nodes.push_back(subtree[i]);
+        }
+        slot++;
+    }
+}
+
+void PointOctree::aggregateColors(std::span<const Rgba> pointColors) {
+    colorSums.assign(nodes.size(), {});
+    nodeColors.resize(nodes.size());
+    if (pointColors.size() < points.size()) {
+        return;
+    }
+
+    parallelFor(nodes.size(), [&](size_t i) {
+        auto& node = nodes[i];
+        if (node.firstChild != -1) return;
+        auto& sum = colorSums[i];
+        for (uint32_t j = node.begin; j < node.end; j++) {
+            auto& color = pointColors[order[j]];
+            if (color[3] == 0) continue;
+            for (int c = 0; c < 3; c++) {
+                sum.rgb[c] += color[c];
+            }
+            sum.visible++;
+        }
+    });
+
+    // Children are always stored after their parent
+    for (size_t i = nodes.size(); i-- > 0;) {
+        auto& node = nodes[i];
+        auto& sum = colorSums[i];
+        for (int child = node.firstChild; child != -1 && child < node.firstChild + node.childCount; child++) {
+            for (int c = 0; c < 3; c++) {
+                sum.rgb[c] += colorSums[child].rgb[c];
+            }
+            sum.visible += colorSums[child].visible;
+        }
+
+        auto& color = nodeColors[i];
+        uint32_t visible = std::max(1u, sum.visible);
+        for (int c = 0; c < 3; c++) {
+            color[c] = static_cast<unsigned char>(sum.rgb[c] / visible);
+        }
+        color[3] = sum.visible > 0 ? 255 : 0;
+    }
+}
+
+void PointOctree::select(const LodCamera& camera, std::span<const Rgba> pointColors, LodSelection& selection) const {
+    selection.clear();
+    if (nodes.empty() || nodeColors.size() != nodes.size()) {
+        return;
+    }
+
+    std::vector<int> stack = { 0 };
+    while (!stack.empty()) {
+        int index = stack.back();
+        stack.pop_back();
+        auto& node = nodes[index];
+
+        if (nodeColors[index][3] == 0) continue;
+
+        // Frustum culling with the bounding sphere of the node
+        double radius = node.halfSize * std::numbers::sqrt3;
+        bool outside = false;
+        for (auto& plane : camera.planes) {
+            double distance = plane[0] * node.center[0] + plane[1] * node.center[1] + plane[2] * node.center[2] + plane[3];
+            if (distance < -radius) {
+                outside = true;
+                break;
+            }
+        }
+        if (outside) continue;
+
+        double projected = radius * camera.pixelScale;
+        if (!camera.parallelProjection) {
+            double distance = std::sqrt(
+                (node.center[0] - camera.position[0]) * (node.center[0] - camera.position[0]) +
+                (node.center[1] - camera.position[1]) * (node.center[1] - camera.position[1]) +
+                (node.center[2] - camera.position[2]) * (node.center[2] - camera.position[2]));
+            projected = distance > radius ? projected / (distance - radius) : INFINITY;
+        }
+
+        if (projected < pixelThreshold && node.end - node.begin > 1) {
+            selection.positions.push_back(node.centroid);
+            selection.colors.push_back(nodeColors[index]);
+            selection.radii.push_back(std::max(1.0f, node.halfSize));
+            selection.aggregatedNodes++;
+        }
+        else if (node.firstChild == -1) {
+            for (uint32_t i = node.begin; i < node.end; i++) {
+                // Filtered points are left out instead of being drawn transparent
+                if (pointColors[order[i]][3] == 0) continue;
+                selection.positions.push_back(points[order[i]]);
+                selection.colors.push_back(pointColors[order[i]]);
+                selection.radii.push_back(1.0f);
+            }
+        }
+        else {
+            for (int child = node.firstChild; child < node.firstChild + node.childCount; child++) {
+                stack.push_back(child);
+            }
+        }
+    }
+}
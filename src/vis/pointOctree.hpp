@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vtkRenderer.h>
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "positionLayout.hpp"
+#include "visUtility.hpp"
+
+// Camera description used by the level of detail traversal
+struct LodCamera {
+    // Inward facing frustum planes (a, b, c, d) with normalized normals
+    std::array<std::array<double, 4>, 6> planes;
+    std::array<double, 3> position;
+    bool parallelProjection = false;
+    // Pixels covered by a unit of world space at unit distance (or at any distance for parallel projection)
+    double pixelScale = 1;
+
+    static LodCamera fromRenderer(vtkRenderer& renderer);
+};
+
+// Points and coarse octree nodes selected for drawing
+struct LodSelection {
+    std::vector<Position> positions;
+    std::vector<Rgba> colors;
+    std::vector<float> radii;
+    // Number of octree nodes that were drawn as a single splat
+    size_t aggregatedNodes = 0;
+
+    void clear() {
+        positions.clear();
+        colors.clear();
+        radii.clear();
+        aggregatedNodes = 0;
+    }
+};
+
+// Octree over neuron positions used for level of detail rendering.
+// Far away or small nodes are drawn as one splat at the centroid of their points with their average color,
+// individual points are emitted only for visible leaves close to the camera.
+class PointOctree {
+    struct Node {
+        Position center;
+        float halfSize;
+        Position centroid;
+        uint32_t begin;
+        uint32_t end;
+        int32_t firstChild = -1;
+        uint8_t childCount = 0;
+    };
+
+    struct ColorSum {
+        std::array<uint32_t, 3> rgb{};
+        uint32_t visible = 0;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> order;
+    std::span<const Position> points;
+
+    std::vector<ColorSum> colorSums;
+    std::vector<Rgba> nodeColors;
+
+    // Fills output[index], which has to exist already, and appends the subtree below it
+    void buildNode(std::vector<Node>& output, int index, uint32_t begin, uint32_t end, Position center, float halfSize, int depth);
+    void splitOctants(uint32_t begin, uint32_t end, Position center, std::array<uint32_t, 9>& bounds);
+
+public:
+    int leafSize = 64;
+    int maxDepth = 16;
+    // Nodes projected to fewer pixels than this are drawn as a single splat
+    double pixelThreshold = 6;
+
+    // `points` has to outlive the octree
+    void build(std::span<const Position> points);
+
+    bool empty() const { return nodes.empty(); }
+
+    size_t memoryBytes() const {
+        return nodes.capacity() * sizeof(Node) + order.capacity() * sizeof(uint32_t)
+            + colorSums.capacity() * sizeof(ColorSum) + nodeColors.capacity() * sizeof(Rgba);
+    }
+
+    // Recomputes the average color of every node from per point colors
+    void aggregateColors(std::span<const Rgba> pointColors);
+
+    void select(const LodCamera& camera, std::span<const Rgba> pointColors, LodSelection& selection) const;
+};
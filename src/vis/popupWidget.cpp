@@ -2,6 +2,10 @@
 #include<QObject>
 #include<QPushButton>
 #include <Qstring>
+#include <QPainter>
+
+#include <algorithm>
+#include <format>
 
 #include "popupWidget.hpp"
 
@@ -107,3 +111,70 @@ PropertiesPopUp::PropertiesPopUp(QWidget* parent, QPushButton* button) :
 
     setLayout(layout);
 }
+
+NeuronHistoryPopUp::NeuronHistoryPopUp(QWidget* parent) :
+    QWidget(parent)
+{
+    setWindowFlags(Qt::Tool);
+    setWindowTitle("Neuron history");
+    setFixedSize(360, 120);
+}
+
+void NeuronHistoryPopUp::setHistory(uint32_t neuron, std::span<const float> history, int timestep) {
+    this->neuron = neuron;
+    this->history.assign(history.begin(), history.end());
+    this->timestep = timestep;
+    update();
+}
+
+void NeuronHistoryPopUp::showHistory(uint32_t neuron, std::span<const float> history, int timestep, QPoint globalPosition) {
+    setHistory(neuron, history, timestep);
+    move(globalPosition + QPoint(15, 15));
+    show();
+}
+
+void NeuronHistoryPopUp::setTimestep(int timestep) {
+    this->timestep = timestep;
+    if (isVisible()) {
+        update();
+    }
+}
+
+void NeuronHistoryPopUp::paintEvent(QPaintEvent*) {
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor(255, 255, 255));
+
+    const int margin = 4;
+    const int titleHeight = 18;
+    QRect plot(margin, titleHeight + margin, width() - 2 * margin, height() - titleHeight - 2 * margin);
+
+    if (history.empty()) {
+        painter.drawText(rect(), Qt::AlignCenter, "Neuron history was not preprocessed.");
+        return;
+    }
+
+    auto [minIt, maxIt] = std::minmax_element(history.begin(), history.end());
+    float min = *minIt;
+    float max = *maxIt;
+    painter.drawText(margin, margin, width() - 2 * margin, titleHeight, Qt::AlignLeft | Qt::AlignVCenter,
+        QString::fromStdString(std::format("Neuron {}   min: {:.4}   max: {:.4}", neuron, min, max)));
+
+    auto yPos = [&](float value) {
+        double unit = max > min ? (value - min) / (max - min) : 0.5;
+        return plot.bottom() - static_cast<int>(unit * plot.height());
+    };
+
+    // Every pixel column shows min and max of its samples, so short spikes stay visible
+    painter.setPen(QPen(QColor(0, 0, 0)));
+    size_t count = history.size();
+    for (int x = 0; x < plot.width(); x++) {
+        size_t begin = count * x / plot.width();
+        size_t end = std::max(begin + 1, count * (x + 1) / plot.width());
+        auto [columnMin, columnMax] = std::minmax_element(history.begin() + begin, history.begin() + std::min(end, count));
+        painter.drawLine(plot.left() + x, yPos(*columnMin), plot.left() + x, yPos(*columnMax));
+    }
+
+    painter.setPen(QPen(QColor(255, 0, 0)));
+    int cursor = plot.left() + static_cast<int>(static_cast<double>(timestep) / count * plot.width());
+    painter.drawLine(cursor, plot.top(), cursor, plot.bottom());
+}
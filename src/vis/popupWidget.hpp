@@ -4,6 +4,9 @@
 #include <QVBoxLayout>
 #include <QLabel>
 
+#include <span>
+#include <vector>
+
 #include "magmaColormap.hpp"
 
 class QPushButton;
@@ -35,4 +38,25 @@ public:
     HistogramPopUp(QWidget* parent, QPushButton* button);
 
     void adjustPosition() override;
-};
\ No newline at end of file
+};
+
+// Sparkline of the whole history of one neuron, shown after clicking a neuron
+class NeuronHistoryPopUp : public QWidget {
+    std::vector<float> history;
+    uint32_t neuron = 0;
+    int timestep = 0;
+
+public:
+    explicit NeuronHistoryPopUp(QWidget* parent);
+
+    void setHistory(uint32_t neuron, std::span<const float> history, int timestep);
+
+    void showHistory(uint32_t neuron, std::span<const float> history, int timestep, QPoint globalPosition);
+
+    void setTimestep(int timestep);
+
+    uint32_t getNeuron() const { return neuron; }
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+};
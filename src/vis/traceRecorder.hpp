@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "utility.hpp"
+
+// Opt-in recording of begin and end events, written as Chrome trace-event JSON that Perfetto and chrome://tracing open.
+// Every thread appends to its own buffer, the buffers are only merged when the trace is written.
+class TraceRecorder {
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    struct Event {
+        // Has to be a string literal, only the pointer is stored
+        const char* name;
+        char phase;
+        Clock::time_point time;
+    };
+
+    // Locked by its thread for every event and by write(), so it is practically never contended
+    struct ThreadBuffer {
+        uint32_t threadId;
+        std::mutex mutex;
+        std::vector<Event> events;
+    };
+
+    std::atomic<bool> enabled = false;
+    Clock::time_point start = Clock::now();
+    std::mutex buffersMutex;
+    // Owned by the recorder, so events of finished threads are kept
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+    ThreadBuffer& localBuffer() {
+        thread_local ThreadBuffer* buffer = nullptr;
+        if (!buffer) {
+            std::lock_guard lock(buffersMutex);
+            buffers.push_back(std::make_unique<ThreadBuffer>());
+            buffers.back()->threadId = static_cast<uint32_t>(buffers.size());
+            buffer = buffers.back().get();
+        }
+        return *buffer;
+    }
+
+    void add(const char* name, char phase, Clock::time_point time) {
+        auto& buffer = localBuffer();
+        std::lock_guard lock(buffer.mutex);
+        buffer.events.push_back({ name, phase, time });
+    }
+
+public:
+    bool isEnabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    void enable() {
+        start = Clock::now();
+        enabled = true;
+    }
+
+    void begin(const char* name, Clock::time_point time = Clock::now()) {
+        if (isEnabled()) add(name, 'B', time);
+    }
+
+    void end(const char* name, Clock::time_point time = Clock::now()) {
+        if (isEnabled()) add(name, 'E', time);
+    }
+
+    // Thread ids are numbered in the order the threads recorded their first event
+    void write(const std::filesystem::path& path) {
+        std::ofstream out(path);
+        checkFile(out);
+        out << std::fixed << std::setprecision(3);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"Brain Visualisation\"}}";
+
+        std::lock_guard lock(buffersMutex);
+        for (auto& buffer : buffers) {
+            std::lock_guard bufferLock(buffer->mutex);
+            for (auto& event : buffer->events) {
+                double micros = std::chrono::duration<double, std::micro>(event.time - start).count();
+                out << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"" << event.phase << "\",\"ts\":" << micros
+                    << ",\"pid\":1,\"tid\":" << buffer->threadId << "}";
+            }
+        }
+        out << "\n]}\n";
+        checkFile(out);
+        std::cout << "Trace written to " << path << "\n";
+    }
+};
+
+inline TraceRecorder& traceRecorder() {
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+// Trace event of a scope that isn't a profiled stage
+class TraceScope {
+    const char* name;
+
+public:
+    explicit TraceScope(const char* name) :
+        name(name)
+    {
+        traceRecorder().begin(name);
+    }
+
+    ~TraceScope() {
+        traceRecorder().end(name);
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
@@ -14,6 +14,8 @@
 #include <random>
 #include <exception>
 
+using Rgba = std::array<unsigned char, 4>;
+
 extern std::mt19937 rand_gen;
 
 extern vtkNew<vtkNamedColors> namedColors;
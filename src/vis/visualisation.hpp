@@ -1,27 +1,58 @@
 #pragma once
 
-#include <vtkArrowSource.h>
-#include <vtkGraphToPolyData.h>
-#include <vtkGlyph3DMapper.h>
 #include <vtkActor.h>
 #include <vtkPointData.h>
 #include <vtkProperty.h>
-#include <vtkGraphLayout.h>
-#include <vtkPassThroughEdgeStrategy.h>
-#include <vtkPassThroughLayoutStrategy.h>
-#include <vtkEdgeLayout.h>
 #include <vtkSmartPointer.h>
 #include <vtkPointGaussianMapper.h>
+#include <vtkCallbackCommand.h>
+#include <vtkRenderWindowInteractor.h>
+#include <vtkInteractorStyleSwitch.h>
+#include <vtkFloatArray.h>
+#include <vtkSphereSource.h>
+#include <vtkCubeSource.h>
+#include <vtkCellArray.h>
+#include <vtkTubeFilter.h>
+#include <vtkPolyDataMapper.h>
 
 #include "visUtility.hpp"
 #include "histogramWidget.hpp"
 #include "histogramSliderWidget.hpp"
 #include "rangeSliderWidget.hpp"
 #include "loaders.hpp"
+#include "pointOctree.hpp"
+#include "popupWidget.hpp"
+#include "neuronHistory.hpp"
+#include "edgeHierarchy.hpp"
+#include "histogramRebinner.hpp"
+#include "frameProfiler.hpp"
+#include "memoryRegistry.hpp"
+#include "datasetDescriptor.hpp"
+#include "comparisonViews.hpp"
+#include "edgeInstances.hpp"
 
 #include "context.hpp"
 
 #include <QLabel>
+#include <QComboBox>
+#include <QCursor>
+#include <QTimer>
+
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+// Draws a proxy of the clusters while the camera moves or the timestep is scrubbed, full detail once the scene was idle
+struct ProgressiveOptions {
+    // Idle time before full detail is drawn again, 0 disables the proxy
+    std::chrono::milliseconds refineDelay{ 0 };
+    // Heaviest edges drawn by the proxy
+    size_t edgeCount = 1000;
+
+    bool enabled() const { return refineDelay.count() > 0; }
+};
 
 struct Widgets {
     HistogramWidget* histogram = nullptr;
@@ -33,6 +64,8 @@ struct Widgets {
     QLabel* maximumValLabel = nullptr;
     QLabel* neuronGlobalPropertiesLabel = nullptr;
     QLabel* neuronCurrentTimestepPropertiesLabel = nullptr;
+    NeuronHistoryPopUp* neuronHistoryPopup = nullptr;
+    QComboBox* attributeComboBox = nullptr;
 };
 
 
@@ -47,55 +80,165 @@ public:
     vtkNew<vtkPointGaussianMapper> pointGaussianMapper;
 
     vtkNew<vtkActor> actor;
-    vtkNew<vtkActor> arrowActor;
-
-    vtkNew<vtkGraphToPolyData> graphToPolyData;
-    vtkNew<vtkArrowSource> arrowSource;
-    vtkNew<vtkGlyph3D> arrowGlyph;
-    vtkNew<vtkPolyDataMapper> arrowMapper;
-
 
-    std::vector<uint16_t> point_map;
+    // Edges of the shown network snapshot between the position clusters
+    EdgeInstances edgeInstances;
+
+    // Progressive refinement, the proxy holds one splat per cluster with the average color of its visible neurons
+    ProgressiveOptions progressive;
+    bool proxyShown = false;
+    vtkNew<vtkPolyData> proxyData;
+    EdgeInstances proxyEdges;
+    std::vector<Edge> shownEdges;
+    QTimer refineTimer;
+    vtkNew<vtkCallbackCommand> interactionCallback;
+
+    std::vector<uint32_t> point_map;
+
+    // Shared by scattering, picking and region selection
+    SpatialIndex originalIndex;
+    SpatialIndex scatteredIndex;
+    SpatialIndex aggregatedIndex;
+
+    // Level of detail, the polydata holds the selected points and nodes while it is enabled
+    PointOctree originalOctree;
+    PointOctree scatteredOctree;
+    LodSelection lodSelection;
+    vtkSmartPointer<vtkUnsignedCharArray> pointColors;
+    // Points inside the point filter, the polydata holds only these while some are filtered and level of detail is off
+    std::vector<uint32_t> visiblePoints;
+    vtkNew<vtkPoints> compactPositions;
+    vtkNew<vtkUnsignedCharArray> compactColors;
+    vtkNew<vtkCallbackCommand> lodCallback;
+    vtkMTimeType lodCameraTime = 0;
+    bool lodEnabled = false;
+    bool lodDirty = true;
+
+    NeuronHistoryStore neuronHistory{ dataFolder };
+    vtkNew<vtkCallbackCommand> clickCallback;
+    std::array<int, 2> pressPosition{};
+    vtkNew<vtkCallbackCommand> keyCallback;
+
+    // Region of interest, shift + drag selects a sphere and ctrl + drag a box around the picked neuron
+    enum class BrushShape { None, Sphere, Box };
+    BrushShape brushShape = BrushShape::None;
+    SpatialIndex::Point brushCenter{};
+    std::array<int, 2> brushPress{};
+    double brushSize = 0;
+    vtkNew<vtkCallbackCommand> brushCallback;
+    vtkNew<vtkSphereSource> brushSphere;
+    vtkNew<vtkCubeSource> brushBox;
+    vtkNew<vtkPolyDataMapper> brushMapper;
+    vtkNew<vtkActor> brushActor;
+
+    // Selected neurons and their statistics, derived views use these instead of the whole dataset while not empty
+    std::vector<uint32_t> selection;
+    AttributeTables selectionData;
+    int selectionAttribute = -1;
+
+    // Histograms of the value range selected with the range slider, cropped global bins until the rebinned ones arrive
+    AttributeTables rangeData;
+    uint64_t rangeGeneration = 0;
+    HistogramRebinner rebinner{ neuronHistory, [this](uint64_t generation, int attribute, AttributeTables tables) {
+        QMetaObject::invokeMethod(this, [this, generation, attribute, tables = std::move(tables)]() mutable {
+            onRebinned(generation, attribute, std::move(tables));
+        }, Qt::QueuedConnection);
+    } };
 
     Range pointFilter = Range::Whole();
 
     int currentTimestep = 0;
     int currentColorAttribute = 0;
     bool derivatives = false;
+    bool pointsScattered = false;
 
     bool edgesVisible = false;
 
-    HistogramDataLoader histogramDataLoader;
+    HistogramDataLoader histogramDataLoader{ [this](int) {
+        QMetaObject::invokeMethod(this, [this]() {
+            enforceMemoryBudget();
+            updateAttributeProgress();
+        }, Qt::QueuedConnection);
+    } };
 
     enum : int { edgesHidden = -1 };
-    int edgeTimestep = edgesHidden;
+    // Network snapshot of the shown edges
+    int edgeSnapshot = edgesHidden;
+
+    // Cut of the edge hierarchy written by ClusterNetwork, drawn as tubes between connexel centroids
+    bool edgeClustersVisible = false;
+    int edgeClusterSnapshot = edgesHidden;
+    size_t edgeClusterCount = 64;
+    vtkNew<vtkPolyData> edgeClusterData;
+    vtkNew<vtkTubeFilter> edgeClusterTubes;
+    vtkNew<vtkPolyDataMapper> edgeClusterMapper;
+    vtkNew<vtkActor> edgeClusterActor;
 
     Widgets widgets;
 
+    // Work requested by slots, merged and done once per event loop turn by flushUpdates(), at most once per frame interval
+    enum Update : unsigned {
+        UpdateRender = 1 << 0,
+        UpdateColors = 1 << 1,
+        UpdateEdges = 1 << 2,
+        UpdateEdgeClusters = 1 << 3,
+        UpdateHistogram = 1 << 4,
+    };
+    unsigned pendingUpdates = 0;
+    bool updateQueued = false;
+    std::chrono::steady_clock::time_point lastUpdate;
+    std::chrono::milliseconds frameInterval{ 16 };
+
+    // Other datasets shown next to this one or subtracted from it, set before loadData()
+    ComparisonViews comparison;
+
+    // Reported memory, histogram tables of other attributes than the current one are evicted when over budget
+    MemoryRegistration histogramMemory{ "histogram tables",
+        [this]() { return histogramDataLoader.memoryBytes(); },
+        [this](size_t bytes) { return histogramDataLoader.evict(bytes, currentColorAttribute); } };
+    MemoryRegistration derivedTablesMemory{ "selection/range tables", [this]() {
+        return selectionData.memoryBytes() + rangeData.memoryBytes();
+    } };
+    MemoryRegistration positionsMemory{ "positions", [this]() {
+        return actualBytes(originalPositions.Get()) + actualBytes(scatteredPositions.Get()) + actualBytes(aggregatedPoints.Get())
+            + point_map.capacity() * sizeof(uint32_t);
+    } };
+    MemoryRegistration spatialIndexMemory{ "spatial indices", [this]() {
+        return originalIndex.memoryBytes() + scatteredIndex.memoryBytes() + aggregatedIndex.memoryBytes();
+    } };
+    MemoryRegistration colorsMemory{ "point colors", [this]() { return actualBytes(pointColors.Get()) + comparison.memoryBytes(); } };
+    MemoryRegistration filteredPointsMemory{ "filtered points", [this]() {
+        return visiblePoints.capacity() * sizeof(uint32_t) + actualBytes(compactPositions.Get()) + actualBytes(compactColors.Get());
+    } };
+    MemoryRegistration levelOfDetailMemory{ "level of detail", [this]() {
+        size_t selectionBytes = lodSelection.positions.capacity() * sizeof(Position) + lodSelection.colors.capacity() * sizeof(Rgba)
+            + lodSelection.radii.capacity() * sizeof(float);
+        // Without level of detail the polydata shares the positions and colors
+        return originalOctree.memoryBytes() + scatteredOctree.memoryBytes() + selectionBytes + (lodEnabled ? actualBytes(polyData.Get()) : 0);
+    } };
+    MemoryRegistration edgesMemory{ "edge instances", [this]() {
+        return edgeInstances.memoryBytes() + proxyEdges.memoryBytes() + shownEdges.capacity() * sizeof(Edge);
+    } };
+    MemoryRegistration proxyMemory{ "interaction proxy", [this]() { return actualBytes(proxyData.Get()); } };
+    MemoryRegistration edgeClustersMemory{ "edge clusters", [this]() {
+        return actualBytes(edgeClusterData.Get()) + actualBytes(edgeClusterTubes->GetOutput());
+    } };
+    MemoryRegistration widgetsMemory{ "histogram widgets", [this]() {
+        return widgets.histogram->memoryBytes() + widgets.histogramSlider->memoryBytes();
+    } };
+    MemoryRegistration neuronHistoryMemory{ "neuron histories", [this]() { return neuronHistory.mappedBytes(); }, {}, true };
+
     Visualisation(Widgets widgets) :
         widgets(widgets) { }
 
     void loadData() {
 
         loadPositions(*originalPositions, *scatteredPositions, *aggregatedPoints, point_map);
-
-        // Convert the graph to a polydata
-        graphToPolyData->EdgeGlyphOutputOn();
-        graphToPolyData->SetEdgeGlyphPosition(0.0);
-
-        // Make a simple edge arrow for glyphing.
-        arrowSource->SetShaftRadius(0.01);
-        arrowSource->SetTipRadius(0.02);
-        arrowSource->Update();
-
-        // Use Glyph3D to repeat the glyph on all edges.
-        arrowGlyph->SetInputConnection(0, graphToPolyData->GetOutputPort(1));
-        arrowGlyph->SetSourceConnection(arrowSource->GetOutputPort());
-        arrowGlyph->SetScaleModeToScaleByVector();
-
-        arrowActor->SetMapper(arrowMapper);
-        arrowActor->GetProperty()->SetOpacity(0.75);
-        arrowActor->GetProperty()->SetColor(namedColors->GetColor3d("DarkGray").GetData());
+        originalIndex = buildSpatialIndex(*originalPositions);
+        scatteredIndex = buildSpatialIndex(*scatteredPositions);
+        aggregatedIndex = buildSpatialIndex(*aggregatedPoints);
+        originalOctree.build(positionSpan(*originalPositions));
+        scatteredOctree.build(positionSpan(*scatteredPositions));
 
         // Points
         polyData->SetPoints(originalPositions);
@@ -124,32 +267,470 @@ public:
         actor->GetProperty()->SetPointSize(30);
         actor->GetProperty()->SetColor(namedColors->GetColor3d("Tomato").GetData());
 
-        context.init({ actor, arrowActor });
+        brushSphere->SetThetaResolution(24);
+        brushSphere->SetPhiResolution(16);
+        brushActor->SetMapper(brushMapper);
+        brushActor->GetProperty()->SetRepresentationToWireframe();
+        brushActor->GetProperty()->SetColor(namedColors->GetColor3d("RoyalBlue").GetData());
+        brushActor->GetProperty()->SetOpacity(0.5);
+        brushActor->PickableOff();
+        brushActor->VisibilityOff();
+
+        edgeClusterTubes->SetInputData(edgeClusterData);
+        edgeClusterTubes->SetNumberOfSides(8);
+        edgeClusterTubes->SetVaryRadiusToVaryRadiusByAbsoluteScalar();
+        edgeClusterMapper->SetInputConnection(edgeClusterTubes->GetOutputPort());
+        edgeClusterMapper->ScalarVisibilityOff();
+        edgeClusterActor->SetMapper(edgeClusterMapper);
+        edgeClusterActor->GetProperty()->SetColor(namedColors->GetColor3d("SteelBlue").GetData());
+        edgeClusterActor->GetProperty()->SetOpacity(0.6);
+        edgeClusterActor->VisibilityOff();
+
+        proxyEdges.actor->VisibilityOff();
+        refineTimer.setSingleShot(true);
+        QObject::connect(&refineTimer, &QTimer::timeout, this, [this]() { showFullDetail(); });
+
+        context.init({ actor, edgeInstances.actor, proxyEdges.actor, brushActor, edgeClusterActor });
+        comparison.init(*context.renderer, *context.renderWindow, pointGaussianMapper->GetSplatShaderCode());
+
+        // Level of detail is selected right before every render
+        lodCallback->SetClientData(this);
+        lodCallback->SetCallback([](vtkObject*, unsigned long, void* clientData, void*) {
+            static_cast<Visualisation*>(clientData)->updateLevelOfDetail();
+        });
+        context.renderer->AddObserver(vtkCommand::StartEvent, lodCallback);
+    }
+
+    // Clicking a neuron without dragging shows its history
+    void initInteraction(vtkRenderWindowInteractor* interactor) {
+        clickCallback->SetClientData(this);
+        clickCallback->SetCallback([](vtkObject* caller, unsigned long eventId, void* clientData, void*) {
+            auto* self = static_cast<Visualisation*>(clientData);
+            auto* interactor = static_cast<vtkRenderWindowInteractor*>(caller);
+            self->onClickEvent(interactor, eventId);
+        });
+        interactor->AddObserver(vtkCommand::LeftButtonPressEvent, clickCallback);
+        interactor->AddObserver(vtkCommand::LeftButtonReleaseEvent, clickCallback);
+
+        // Brushing runs before the interactor style and aborts the event, so the camera doesn't move meanwhile
+        brushCallback->SetClientData(this);
+        brushCallback->SetCallback([](vtkObject* caller, unsigned long eventId, void* clientData, void*) {
+            auto* self = static_cast<Visualisation*>(clientData);
+            auto* interactor = static_cast<vtkRenderWindowInteractor*>(caller);
+            if (self->onBrushEvent(interactor, eventId)) {
+                self->brushCallback->SetAbortFlag(1);
+            }
+        });
+        interactor->AddObserver(vtkCommand::LeftButtonPressEvent, brushCallback, 1.0f);
+        interactor->AddObserver(vtkCommand::MouseMoveEvent, brushCallback, 1.0f);
+        interactor->AddObserver(vtkCommand::LeftButtonReleaseEvent, brushCallback, 1.0f);
+
+        // Rotating, panning and zooming are reported by the interactor style
+        interactionCallback->SetClientData(this);
+        interactionCallback->SetCallback([](vtkObject*, unsigned long eventId, void* clientData, void*) {
+            auto* self = static_cast<Visualisation*>(clientData);
+            if (eventId == vtkCommand::StartInteractionEvent) {
+                self->beginInteraction();
+            }
+            else {
+                self->endInteraction();
+            }
+        });
+        vtkInteractorObserver* style = interactor->GetInteractorStyle();
+        // The default style forwards the events to the camera style it switched to
+        if (auto* styleSwitch = vtkInteractorStyleSwitch::SafeDownCast(style)) {
+            style = styleSwitch->GetCurrentStyle();
+        }
+        if (style) {
+            style->AddObserver(vtkCommand::StartInteractionEvent, interactionCallback);
+            style->AddObserver(vtkCommand::EndInteractionEvent, interactionCallback);
+        }
+
+        keyCallback->SetClientData(this);
+        keyCallback->SetCallback([](vtkObject* caller, unsigned long, void* clientData, void*) {
+            auto* self = static_cast<Visualisation*>(clientData);
+            auto* interactor = static_cast<vtkRenderWindowInteractor*>(caller);
+            auto* key = interactor->GetKeySym();
+            if (key && std::string_view(key) == "F2") {
+                self->context.toggleProfilerOverlay();
+            }
+        });
+        interactor->AddObserver(vtkCommand::KeyPressEvent, keyCallback);
+    }
+
+    // Greys out attributes that are still loading
+    void updateAttributeProgress() {
+        auto* comboBox = widgets.attributeComboBox;
+        int loadedCount = 0;
+        for (int i = 0; i < comboBox->count(); i++) {
+            bool loaded = histogramDataLoader.isLoaded(i);
+            loadedCount += loaded;
+            comboBox->setItemData(i, loaded ? QVariant() : QVariant(QBrush(Qt::gray)), Qt::ForegroundRole);
+            comboBox->setItemData(i, loaded ? QVariant() : QVariant("Loading..."), Qt::ToolTipRole);
+        }
+        comboBox->setToolTip(QString::fromStdString(std::format("{} of {} attributes loaded", loadedCount, comboBox->count())));
     }
 
     void firstRender() {
         loadHistogramData(0);
-        reloadColors(0, 0, false);
-        reloadEdges();
-        context.render();
+        scheduleUpdate(UpdateColors | UpdateEdges);
     }
 
 private:
 
+    // Marks the scene dirty, all requests until the next flush are done once. Every request also renders.
+    void scheduleUpdate(unsigned updates) {
+        pendingUpdates |= updates | UpdateRender;
+        if (updateQueued) {
+            return;
+        }
+        updateQueued = true;
+        // The first request after a pause is flushed in the next event loop turn, bursts wait for the frame interval
+        auto sinceLast = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - lastUpdate);
+        auto delay = std::max(frameInterval - sinceLast, std::chrono::milliseconds(0));
+        QTimer::singleShot(delay, this, [this]() { flushUpdates(); });
+    }
+
+    void flushUpdates() {
+        ScopedTimer timer(ProfileStage::Update, "flushUpdates");
+        updateQueued = false;
+        lastUpdate = std::chrono::steady_clock::now();
+        auto updates = std::exchange(pendingUpdates, 0u);
+
+        // Edges and histograms follow the timestep set by the colors
+        if (updates & UpdateColors) {
+            reloadColors(currentTimestep, currentColorAttribute, derivatives);
+        }
+        if (updates & UpdateEdges) {
+            reloadEdges();
+        }
+        if (updates & UpdateEdgeClusters) {
+            reloadEdgeClusters();
+        }
+        if (updates & UpdateHistogram) {
+            reloadHistogram(currentTimestep, currentColorAttribute);
+        }
+        if (updates & UpdateRender) {
+            context.render();
+        }
+    }
+
+    void beginInteraction() {
+        if (!progressive.enabled()) {
+            return;
+        }
+        refineTimer.stop();
+        if (!proxyShown) {
+            showProxy();
+        }
+    }
+
+    void endInteraction() {
+        if (proxyShown) {
+            refineTimer.start(progressive.refineDelay);
+        }
+    }
+
+    void showProxy() {
+        proxyShown = true;
+        updateProxy();
+        pointGaussianMapper->SetInputData(proxyData);
+        pointGaussianMapper->SetScaleArray("radius");
+        edgeInstances.actor->VisibilityOff();
+        proxyEdges.actor->SetVisibility(edgesVisible);
+    }
+
+    void showFullDetail() {
+        proxyShown = false;
+        pointGaussianMapper->SetInputData(polyData);
+        pointGaussianMapper->SetScaleArray(lodEnabled ? "radius" : nullptr);
+        edgeInstances.actor->VisibilityOn();
+        proxyEdges.actor->VisibilityOff();
+        scheduleUpdate(UpdateRender);
+    }
+
+    // One splat per cluster at the centroid of its visible neurons, its area grows with their number
+    void updateProxy() {
+        if (!pointColors) {
+            return;
+        }
+        ScopedTimer timer(ProfileStage::Upload, "updateProxy");
+        struct Sum {
+            std::array<double, 3> position{};
+            std::array<uint32_t, 3> rgb{};
+            uint32_t count = 0;
+        };
+        // Colors are per neuron and averaged per cluster. Scattered points don't belong to single neurons, there the
+        // proxy is drawn at the cluster centroids, otherwise at the centroids of the visible neurons.
+        auto clusterPositions = positionSpan(*aggregatedPoints);
+        auto positions = positionSpan(*originalPositions);
+        auto colors = colorSpan(*pointColors);
+        std::vector<Sum> sums(clusterPositions.size());
+        size_t neuronCount = std::min({ colors.size(), point_map.size(), positions.size() });
+        for (size_t i = 0; i < neuronCount; i++) {
+            if (colors[i][3] == 0 || point_map[i] >= sums.size()) continue;
+            auto& sum = sums[point_map[i]];
+            for (int c = 0; c < 3; c++) {
+                sum.position[c] += positions[i][c];
+                sum.rgb[c] += colors[i][c];
+            }
+            sum.count++;
+        }
+
+        std::vector<Position> proxyPositions;
+        vtkNew<vtkUnsignedCharArray> proxyColors;
+        proxyColors->SetNumberOfComponents(4);
+        vtkNew<vtkFloatArray> radii;
+        radii->SetName("radius");
+        for (size_t cluster = 0; cluster < sums.size(); cluster++) {
+            auto& sum = sums[cluster];
+            if (sum.count == 0) continue;
+            Position position = clusterPositions[cluster];
+            Rgba color;
+            for (int c = 0; c < 3; c++) {
+                if (!pointsScattered) {
+                    position[c] = static_cast<float>(sum.position[c] / sum.count);
+                }
+                color[c] = static_cast<unsigned char>(sum.rgb[c] / sum.count);
+            }
+            color[3] = 255;
+            proxyPositions.push_back(position);
+            proxyColors->InsertNextTypedTuple(color.data());
+            radii->InsertNextValue(std::sqrt(static_cast<float>(sum.count)));
+        }
+
+        vtkNew<vtkPoints> points;
+        copyPositions(*points, proxyPositions);
+        proxyData->SetPoints(points);
+        proxyData->GetPointData()->SetScalars(proxyColors);
+        proxyData->GetPointData()->AddArray(radii);
+    }
+
+    // VTK reports memory in KiB
+    template<typename T>
+    static size_t actualBytes(T* object) {
+        return object ? static_cast<size_t>(object->GetActualMemorySize()) * 1024 : 0;
+    }
+
+    void enforceMemoryBudget() {
+        if (memoryRegistry().enforceBudget() > 0) {
+            updateAttributeProgress();
+        }
+    }
+
+    void onClickEvent(vtkRenderWindowInteractor* interactor, unsigned long eventId) {
+        auto* position = interactor->GetEventPosition();
+        if (eventId == vtkCommand::LeftButtonPressEvent) {
+            pressPosition = { position[0], position[1] };
+            return;
+        }
+
+        const int clickTolerance = 3;
+        if (std::abs(position[0] - pressPosition[0]) > clickTolerance || std::abs(position[1] - pressPosition[1]) > clickTolerance) {
+            return;
+        }
+
+        if (auto neuron = pickNeuron(position[0], position[1])) {
+            showNeuronHistory(*neuron, QCursor::pos());
+        }
+    }
+
+    // Casts a ray through the display position and returns the neuron of the first point it hits
+    std::optional<uint32_t> pickNeuron(int x, int y) {
+        auto worldPoint = [&](double depth) {
+            std::array<double, 4> point;
+            context.renderer->SetDisplayPoint(x, y, depth);
+            context.renderer->DisplayToWorld();
+            context.renderer->GetWorldPoint(point.data());
+            return SpatialIndex::Point{ point[0] / point[3], point[1] / point[3], point[2] / point[3] };
+        };
+
+        double radius = std::max(pointGaussianMapper->GetScaleFactor(), 0.1);
+        uint32_t point = activeIndex().firstAlongSegment(worldPoint(0.0), worldPoint(1.0), radius);
+        if (point == SpatialIndex::none) {
+            return std::nullopt;
+        }
+        // A scattered point stands for its cluster, the first neuron of the cluster is shown
+        auto neurons = neuronsOf({ point });
+        if (neurons.empty()) {
+            return std::nullopt;
+        }
+        return neurons.front();
+    }
+
+    SpatialIndex& activeIndex() {
+        return pointsScattered ? scatteredIndex : originalIndex;
+    }
+
+    // Neurons of points of activeIndex(). Scattered points are drawn in patterns around the cluster centroids,
+    // each of them stands for all neurons of its cluster.
+    std::vector<uint32_t> neuronsOf(std::vector<uint32_t> points) {
+        if (!pointsScattered) {
+            return points;
+        }
+        size_t clusterCount = aggregatedPoints->GetNumberOfPoints();
+        size_t pointsPerCluster = clusterCount > 0 ? scatteredPositions->GetNumberOfPoints() / clusterCount : 0;
+        if (pointsPerCluster == 0) {
+            return {};
+        }
+        std::vector<bool> hitClusters(clusterCount);
+        for (auto point : points) {
+            if (point / pointsPerCluster < clusterCount) {
+                hitClusters[point / pointsPerCluster] = true;
+            }
+        }
+        std::vector<uint32_t> neurons;
+        for (uint32_t neuron = 0; neuron < point_map.size(); neuron++) {
+            if (point_map[neuron] < clusterCount && hitClusters[point_map[neuron]]) {
+                neurons.push_back(neuron);
+            }
+        }
+        return neurons;
+    }
+
+    // Returns true when the event was consumed by brushing
+    bool onBrushEvent(vtkRenderWindowInteractor* interactor, unsigned long eventId) {
+        auto* position = interactor->GetEventPosition();
+
+        if (eventId == vtkCommand::LeftButtonPressEvent) {
+            if (!interactor->GetShiftKey() && !interactor->GetControlKey()) {
+                return false;
+            }
+            auto neuron = pickNeuron(position[0], position[1]);
+            if (!neuron) {
+                // Shift or ctrl click without a neuron, or without dragging, clears the selection
+                setSelection({});
+                return true;
+            }
+            brushShape = interactor->GetShiftKey() ? BrushShape::Sphere : BrushShape::Box;
+            brushPress = { position[0], position[1] };
+            brushCenter = activeIndex().point(*neuron);
+            brushSize = 0;
+            updateBrushActor();
+            return true;
+        }
+
+        if (brushShape == BrushShape::None) {
+            return false;
+        }
+
+        // The brush grows with the distance of the cursor from the center, measured in the plane of the center
+        std::array<double, 4> center{ brushCenter[0], brushCenter[1], brushCenter[2], 1 };
+        context.renderer->SetWorldPoint(center.data());
+        context.renderer->WorldToDisplay();
+        double centerDepth = context.renderer->GetDisplayPoint()[2];
+
+        std::array<double, 4> cursor;
+        context.renderer->SetDisplayPoint(position[0], position[1], centerDepth);
+        context.renderer->DisplayToWorld();
+        context.renderer->GetWorldPoint(cursor.data());
+        brushSize = std::sqrt(SpatialIndex::dist2(brushCenter, { cursor[0] / cursor[3], cursor[1] / cursor[3], cursor[2] / cursor[3] }));
+
+        if (eventId == vtkCommand::MouseMoveEvent) {
+            updateBrushActor();
+            scheduleUpdate(UpdateRender);
+            return true;
+        }
+
+        auto shape = brushShape;
+        brushShape = BrushShape::None;
+        const int clickTolerance = 3;
+        if (std::abs(position[0] - brushPress[0]) <= clickTolerance && std::abs(position[1] - brushPress[1]) <= clickTolerance) {
+            setSelection({});
+        }
+        else if (shape == BrushShape::Sphere) {
+            setSelection(neuronsOf(activeIndex().withinRadius(brushCenter, brushSize)));
+        }
+        else {
+            SpatialIndex::Point min, max;
+            for (int axis = 0; axis < 3; axis++) {
+                min[axis] = brushCenter[axis] - brushSize;
+                max[axis] = brushCenter[axis] + brushSize;
+            }
+            setSelection(neuronsOf(activeIndex().withinBox(min, max)));
+        }
+        return true;
+    }
+
+    void updateBrushActor() {
+        if (brushShape == BrushShape::Sphere) {
+            brushSphere->SetCenter(brushCenter.data());
+            brushSphere->SetRadius(brushSize);
+            brushMapper->SetInputConnection(brushSphere->GetOutputPort());
+        }
+        else {
+            brushBox->SetCenter(brushCenter.data());
+            brushBox->SetXLength(2 * brushSize);
+            brushBox->SetYLength(2 * brushSize);
+            brushBox->SetZLength(2 * brushSize);
+            brushMapper->SetInputConnection(brushBox->GetOutputPort());
+        }
+        brushActor->VisibilityOn();
+    }
+
+    void setSelection(std::vector<uint32_t> neurons) {
+        ScopedTimer timer(ProfileStage::Update, "setSelection");
+        selection = std::move(neurons);
+        selectionData = {};
+        selectionAttribute = -1;
+        brushActor->SetVisibility(!selection.empty());
+
+        loadHistogramData(currentColorAttribute, false);
+        updateHistogramRange();
+        widgets.histogramSlider->update();
+        scheduleUpdate(UpdateColors | UpdateHistogram);
+    }
+
+    // Statistics and histograms of the selection, or of all neurons when nothing is selected
+    AttributeData getAttributeData(int colorAttribute) {
+        auto whole = histogramDataLoader.getAttributeData(colorAttribute);
+        // The statistics of a selection are computed from the neuron histories
+        if (selection.empty() || !neuronHistory.isAvailable(colorAttribute)) {
+            return whole;
+        }
+
+        if (selectionAttribute != colorAttribute) {
+            selectionAttribute = colorAttribute;
+
+            // Same bins as the preprocessed histograms, so the subset is comparable to the whole dataset
+            int binCount = whole.histogram.empty() ? 64 : static_cast<int>(whole.histogram[0].size());
+            Range valueRange{ whole.globalStatistics.min, whole.globalStatistics.max };
+            selectionData = computeAttributeTables(neuronHistory.table(colorAttribute), neuronHistory.timestepCount(colorAttribute),
+                selection, valueRange, binCount);
+        }
+        return selectionData.empty() ? whole : selectionData.view();
+    }
+
+    void showNeuronHistory(uint32_t neuron, QPoint globalPosition) {
+        auto history = neuronHistory.history(currentColorAttribute, neuron);
+        widgets.neuronHistoryPopup->showHistory(neuron, history, currentTimestep, globalPosition);
+    }
+
     void reloadColors(int timestep, int colorAttribute, bool derivatives) {
         currentColorAttribute = colorAttribute;
         currentTimestep = timestep;
 
-        std::cout << std::format("Reloading colors - timestep: {}, attribute: {}\n", timestep * 100, colorAttribute);
         widgets.histogramSliderLabel->setTimestep(timestep);
 
-        auto attributeData = histogramDataLoader.getAttributeData(currentColorAttribute);
+        auto attributeData = getAttributeData(currentColorAttribute);
 
         double labelMin = attributeData.globalStatistics.min;
         double labelMax = attributeData.globalStatistics.max;
 
-        if (derivatives) {
-            std::tie(labelMin, labelMax) = diffMinMax(timestep, colorAttribute);
+        if (comparison.options.difference) {
+            auto difference = loadDifferenceColors(timestep, colorAttribute, dataFolder, comparison.options.folders[0], pointFilter);
+            pointColors = difference.colors;
+            labelMin = -difference.maxDifference;
+            labelMax = difference.maxDifference;
+        }
+        else {
+            if (derivatives) {
+                std::tie(labelMin, labelMax) = diffMinMax(timestep, colorAttribute);
+            }
+            // The compared datasets are read by workers meanwhile, with the value range of this one
+            comparison.startLoading(timestep, colorAttribute, labelMin, labelMax, pointFilter, derivatives);
+            pointColors = loadColors(timestep, colorAttribute, labelMin, labelMax, pointFilter, derivatives).Get();
+            comparison.finishLoading();
         }
 
         widgets.minimumValLabel->setText(QString::fromStdString(std::format("{:.2}", std::lerp(labelMin, labelMax, pointFilter.lower_bound))));
@@ -161,61 +742,208 @@ private:
             curStatistics.min, curStatistics.max, curStatistics.mean);
         widgets.neuronCurrentTimestepPropertiesLabel->setText(QString::fromStdString(neuronCurrentPropertiesString));
 
-        auto colors = loadColors(timestep, colorAttribute, labelMin, labelMax, pointFilter, derivatives);
+        applyColors();
+    }
+
+    PointOctree& activeOctree() {
+        return pointsScattered ? scatteredOctree : originalOctree;
+    }
+
+    vtkPoints* activePositions() {
+        return pointsScattered ? scatteredPositions.Get() : originalPositions.Get();
+    }
+
+    void applyColors() {
+        ScopedTimer timer(ProfileStage::Upload, "applyColors");
+        // The compared colors are one per neuron, so those views keep the original positions when scattering
+        comparison.setPositions(originalPositions);
+        if (lodEnabled) {
+            activeOctree().aggregateColors(colorSpan(*pointColors));
+            lodDirty = true;
+        }
+        else {
+            // Scattered points aren't one per neuron, point i takes the color of neuron i like with shared arrays,
+            // points without a color are left out
+            auto positions = positionSpan(*activePositions());
+            auto colors = colorSpan(*pointColors);
+            colors = colors.first(std::min(colors.size(), positions.size()));
+            visibleIndices(colors, visiblePoints);
+            if (visiblePoints.size() == colors.size() && colors.size() == positions.size()) {
+                // Nothing is filtered, the polydata shares the positions and colors
+                polyData->SetPoints(activePositions());
+                polyData->GetPointData()->SetScalars(pointColors);
+                compactPositions->Initialize();
+                compactColors->Initialize();
+            }
+            else {
+                compactPoints(positions, colors, visiblePoints, *compactPositions, *compactColors);
+                polyData->SetPoints(compactPositions);
+                polyData->GetPointData()->SetScalars(compactColors);
+            }
+        }
+        if (proxyShown) {
+            updateProxy();
+        }
+    }
+
+    void updateLevelOfDetail() {
+        // The proxy is drawn instead, the selection is updated once full detail is drawn again
+        if (!lodEnabled || !pointColors || proxyShown) {
+            return;
+        }
+        auto cameraTime = context.renderer->GetActiveCamera()->GetMTime();
+        if (!lodDirty && cameraTime == lodCameraTime) {
+            return;
+        }
+        lodDirty = false;
+        lodCameraTime = cameraTime;
+        ScopedTimer timer(ProfileStage::Upload, "updateLevelOfDetail");
+
+        activeOctree().select(LodCamera::fromRenderer(*context.renderer), colorSpan(*pointColors), lodSelection);
+
+        vtkNew<vtkPoints> points;
+        copyPositions(*points, lodSelection.positions);
+
+        vtkNew<vtkUnsignedCharArray> colors;
+        colors->SetNumberOfComponents(4);
+        colors->SetNumberOfTuples(lodSelection.colors.size());
+        std::memcpy(colors->GetPointer(0), lodSelection.colors.data(), lodSelection.colors.size() * sizeof(Rgba));
+
+        vtkNew<vtkFloatArray> radii;
+        radii->SetName("radius");
+        radii->SetNumberOfTuples(lodSelection.radii.size());
+        std::memcpy(radii->GetPointer(0), lodSelection.radii.data(), lodSelection.radii.size() * sizeof(float));
+
+        polyData->SetPoints(points);
         polyData->GetPointData()->SetScalars(colors);
+        polyData->GetPointData()->AddArray(radii);
     }
 
     void reloadEdges() {
-        int newEdgeTimestep = edgesVisible ? currentTimestep / 100 * 100 : edgesHidden;
-        if (edgeTimestep == newEdgeTimestep) {
+        int newSnapshot = edgesVisible ? dataset().snapshotOf(currentTimestep) : edgesHidden;
+        if (edgeSnapshot == newSnapshot) {
             return;
         }
-        edgeTimestep = newEdgeTimestep;
-        std::cout << std::format("Edges reloaded with timestep {}\n", newEdgeTimestep);
-
-        vtkNew<vtkMutableDirectedGraph> g;
-        g->SetNumberOfVertices(aggregatedPoints->GetNumberOfPoints());
-        g->SetPoints(aggregatedPoints);
+        edgeSnapshot = newSnapshot;
 
+        shownEdges.clear();
         if (edgesVisible) {
-            loadEdges(*g, point_map, currentTimestep);
+            shownEdges = loadEdges(currentTimestep);
         }
 
-        vtkNew<vtkGraphLayout> layout;
-        vtkNew<vtkPassThroughLayoutStrategy> strategy;
-        layout->SetInputData(g);
-        layout->SetLayoutStrategy(strategy);
+        ScopedTimer timer(ProfileStage::Upload, "reloadEdges instances");
+        edgeInstances.update(*aggregatedPoints, shownEdges);
+        // Edges are loaded heaviest first
+        proxyEdges.update(*aggregatedPoints, std::span(shownEdges).first(std::min(shownEdges.size(), progressive.edgeCount)));
+        proxyEdges.actor->SetVisibility(proxyShown && edgesVisible);
+    }
 
-        vtkNew<vtkPassThroughEdgeStrategy> edgeStrategy;
-        vtkNew<vtkEdgeLayout> edgeLayout;
-        edgeLayout->SetLayoutStrategy(edgeStrategy);
-        edgeLayout->SetInputConnection(layout->GetOutputPort());
+    void reloadEdgeClusters() {
+        int newSnapshot = edgeClustersVisible ? dataset().snapshotOf(currentTimestep) : edgesHidden;
+        if (edgeClusterSnapshot == newSnapshot) {
+            return;
+        }
+        edgeClusterSnapshot = newSnapshot;
+        edgeClusterActor->SetVisibility(edgeClustersVisible);
+        if (!edgeClustersVisible) {
+            return;
+        }
 
-        graphToPolyData->SetInputConnection(edgeLayout->GetOutputPort());
-        graphToPolyData->Update();
+        auto path = dataFolder / edgeHierarchyPath(dataset().snapshotStep(newSnapshot));
+        if (!std::filesystem::exists(path)) {
+            std::cout << "File " << path << " doesn't exist, run ClusterNetwork to create edge hierarchies.\n";
+            edgeClusterActor->VisibilityOff();
+            return;
+        }
+        auto hierarchy = [&]() {
+            ScopedTimer timer(ProfileStage::Io, "readEdgeHierarchy");
+            return readEdgeHierarchy(path);
+        }();
+        auto cut = hierarchy.cut(edgeClusterCount);
+
+        float maxWeight = 0;
+        for (auto node : cut) {
+            maxWeight = std::max(maxWeight, hierarchy.nodes[node].weight);
+        }
+
+        ScopedTimer timer(ProfileStage::Upload, "reloadEdgeClusters geometry");
+        vtkNew<vtkPoints> points;
+        vtkNew<vtkCellArray> lines;
+        vtkNew<vtkFloatArray> radii;
+        radii->SetName("radius");
+        for (auto node : cut) {
+            auto& cluster = hierarchy.nodes[node];
+            // Tube area is proportional to the number of edges in the cluster
+            float radius = 0.2f + 1.5f * std::sqrt(cluster.weight / std::max(maxWeight, 1.0f));
+            vtkIdType ids[2] = {
+                points->InsertNextPoint(cluster.source[0], cluster.source[1], cluster.source[2]),
+                points->InsertNextPoint(cluster.target[0], cluster.target[1], cluster.target[2]),
+            };
+            lines->InsertNextCell(2, ids);
+            radii->InsertNextValue(radius);
+            radii->InsertNextValue(radius);
+        }
 
-        arrowMapper->SetInputConnection(arrowGlyph->GetOutputPort());
-        arrowMapper->Update();
+        edgeClusterData->SetPoints(points);
+        edgeClusterData->SetLines(lines);
+        edgeClusterData->GetPointData()->SetScalars(radii);
     }
 
-    void loadHistogramData(int colorAttribute) {
-        auto t1 = std::chrono::high_resolution_clock::now();
+    void setHistogramTables(AttributeData data) {
+        widgets.histogram->setTableData(data.histogram, data.summary, data.globalStatistics);
+        widgets.histogramSlider->setTableData(data.histogram, data.summary, data.globalStatistics);
+        widgets.histogram->update();
+        widgets.histogramSlider->update();
+    }
 
-        auto attributeData = histogramDataLoader.getAttributeData(colorAttribute);
+    // Shows the bins of the filtered value range right away and requests rebinned histograms of the range
+    void updateHistogramRange() {
+        auto attributeData = getAttributeData(currentColorAttribute);
+        if (pointFilter.lower_bound <= 0 && pointFilter.upper_bound >= 1) {
+            rebinner.cancel();
+            rangeData = {};
+            setHistogramTables(attributeData);
+            return;
+        }
 
-        auto globalStats = attributeData.globalStatistics;
-        widgets.histogram->setTableData(attributeData.histogram, attributeData.summary, 
-            globalStats);
+        Range dataRange{ attributeData.globalStatistics.min, attributeData.globalStatistics.max };
+        Range valueRange{
+            std::lerp(dataRange.lower_bound, dataRange.upper_bound, pointFilter.lower_bound),
+            std::lerp(dataRange.lower_bound, dataRange.upper_bound, pointFilter.upper_bound),
+        };
+
+        rangeData = cropAttributeTables(attributeData, dataRange, valueRange);
+        rangeData.globalStatistics.min = valueRange.lower_bound;
+        rangeData.globalStatistics.max = valueRange.upper_bound;
+        setHistogramTables(rangeData.view());
+
+        if (neuronHistory.isAvailable(currentColorAttribute)) {
+            int binCount = attributeData.histogram.empty() ? 64 : static_cast<int>(attributeData.histogram[0].size());
+            rangeGeneration = rebinner.request(currentColorAttribute, valueRange, binCount, selection);
+        }
+    }
 
-        widgets.histogramSlider->setTableData(attributeData.histogram, attributeData.summary,
-            globalStats);
+    void onRebinned(uint64_t generation, int attribute, AttributeTables tables) {
+        if (generation != rangeGeneration || !rebinner.isCurrent(generation) || attribute != currentColorAttribute || tables.empty()) {
+            return;
+        }
+        // Keep the value range as the vertical scale of the summary, like the cropped tables
+        tables.globalStatistics.min = rangeData.globalStatistics.min;
+        tables.globalStatistics.max = rangeData.globalStatistics.max;
+        rangeData = std::move(tables);
+        setHistogramTables(rangeData.view());
+    }
 
-        auto t2 = std::chrono::high_resolution_clock::now();
-        std::cout << std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1) << "\n";
-        std::cout << "Histogram data for " << attributeToString(colorAttribute) << " loaded.\n";
+    void loadHistogramData(int colorAttribute, bool resetFilter = true) {
+        auto attributeData = getAttributeData(colorAttribute);
+        rebinner.cancel();
+        rangeData = {};
+        setHistogramTables(attributeData);
 
-        widgets.rangeSlider->setLowValue(0);
-        widgets.rangeSlider->setHighValue(100);
+        if (resetFilter) {
+            widgets.rangeSlider->setLowValue(0);
+            widgets.rangeSlider->setHighValue(100);
+        }
 
         auto neuronPropertiesString = std::format("min: {}\nmax: {}\nmean: {:.5}",
             attributeData.globalStatistics.min, attributeData.globalStatistics.max, attributeData.globalStatistics.mean);
@@ -233,83 +961,120 @@ private:
 
 public slots:
     void setPointScattering(int state) {
-        bool scatter = state == Qt::Checked;
-        if (scatter) {
-            polyData->SetPoints(scatteredPositions);
+        ScopedTimer timer(ProfileStage::Update, "setPointScattering");
+        pointsScattered = state == Qt::Checked;
+        applyColors();
+        scheduleUpdate(UpdateRender);
+    }
+
+    void setLevelOfDetail(int state) {
+        ScopedTimer timer(ProfileStage::Update, "setLevelOfDetail");
+        lodEnabled = state == Qt::Checked;
+        if (lodEnabled) {
+            pointGaussianMapper->SetScaleArray("radius");
         }
         else {
-            polyData->SetPoints(originalPositions);
+            pointGaussianMapper->SetScaleArray(proxyShown ? "radius" : nullptr);
+            polyData->GetPointData()->RemoveArray("radius");
         }
-        context.render();
+        applyColors();
+        scheduleUpdate(UpdateRender);
     }
 
     void showDerivatives(int state) {
+        ScopedTimer timer(ProfileStage::Update, "showDerivatives");
         derivatives = state == Qt::Checked;
-        reloadColors(currentTimestep, currentColorAttribute, derivatives);
-        context.render();
+        scheduleUpdate(UpdateColors);
     }
 
     void setPointFilter(unsigned low, unsigned hight) {
+        ScopedTimer timer(ProfileStage::Update, "setPointFilter");
         pointFilter = Range{ low / 100.0, hight / 100.0 };
-        reloadColors(currentTimestep, currentColorAttribute, derivatives);
-        context.render();
+        updateHistogramRange();
+        scheduleUpdate(UpdateColors);
     }
 
     void changeTimestep(int timestep) {
-        reloadColors(timestep, currentColorAttribute, derivatives);
-        reloadHistogram(currentTimestep, currentColorAttribute);
-        reloadEdges();
-        context.render();
+        ScopedTimer timer(ProfileStage::Update, "changeTimestep");
+        currentTimestep = timestep;
+        widgets.neuronHistoryPopup->setTimestep(timestep);
+        // Scrubbing draws the proxy like moving the camera
+        beginInteraction();
+        endInteraction();
+        scheduleUpdate(UpdateColors | UpdateHistogram | UpdateEdges | UpdateEdgeClusters);
     }
 
     void changePointSize(int size) {
+        TraceScope trace("changePointSize");
         pointGaussianMapper->SetScaleFactor(size / 100.0);
-        context.render();
+        comparison.setScaleFactor(size / 100.0);
+        scheduleUpdate(UpdateRender);
     }
 
     void changeTimestepRange(int sliderValue) {
+        TraceScope trace("changeTimestepRange");
         const int minVal = 0;
-        const int maxVal = 9999;
+        const int maxVal = static_cast<int>(dataset().timestepCount) - 1;
+        const int window = std::min(500, maxVal);
 
-        int lowerBoundary = std::max(sliderValue - 250, minVal);
-        int upperBoundary = std::min(sliderValue + 250, maxVal);
+        int lowerBoundary = std::max(sliderValue - window / 2, minVal);
+        int upperBoundary = std::min(sliderValue + window / 2, maxVal);
 
-        if (lowerBoundary == minVal) upperBoundary = 500;
-        if (upperBoundary == maxVal) lowerBoundary = maxVal - 500;
+        if (lowerBoundary == minVal) upperBoundary = window;
+        if (upperBoundary == maxVal) lowerBoundary = maxVal - window;
         widgets.histogram->setVisibleRange(lowerBoundary, upperBoundary);
-
-        std::cout << "Slider value:" << std::to_string(sliderValue) << std::endl;
         changeTimestep(sliderValue);
     }
 
     void changeDrawMode(int modeType) {
+        TraceScope trace("changeDrawMode");
         widgets.histogram->changeDrawMode((HistogramDrawMode)modeType);
         widgets.histogramSlider->changeDrawMode((HistogramDrawMode)modeType);
-        reloadHistogram(currentTimestep, currentColorAttribute);
         widgets.histogramSlider->update();
+        scheduleUpdate(UpdateHistogram);
     }
 
     void changeColorAttribute(int colorAttribute) {
+        ScopedTimer timer(ProfileStage::Update, "changeColorAttribute");
         pointFilter = Range::Whole();
+        // Resetting the range slider already refers to the new attribute
+        currentColorAttribute = colorAttribute;
         loadHistogramData(colorAttribute);
-        reloadColors(currentTimestep, colorAttribute, derivatives);
-        reloadHistogram(currentTimestep, colorAttribute);
-        context.render();
         widgets.histogramSlider->update();
+        scheduleUpdate(UpdateColors | UpdateHistogram);
+
+        if (widgets.neuronHistoryPopup->isVisible()) {
+            auto neuron = widgets.neuronHistoryPopup->getNeuron();
+            widgets.neuronHistoryPopup->setHistory(neuron, neuronHistory.history(colorAttribute, neuron), currentTimestep);
+        }
+        enforceMemoryBudget();
+    }
+
+    // Called when an attribute is highlighted in the combo box, so it is likely ready when it is picked
+    void prefetchAttribute(int colorAttribute) {
+        TraceScope trace("prefetchAttribute");
+        histogramDataLoader.request(colorAttribute);
     }
 
     void showEdges(int state) {
+        ScopedTimer timer(ProfileStage::Update, "showEdges");
         if (state == Qt::Checked) {
             edgesVisible = true;
         }
         else {
             edgesVisible = false;
         }
-        reloadEdges();
-        context.render();
+        scheduleUpdate(UpdateEdges);
+    }
+
+    void showEdgeClusters(int state) {
+        ScopedTimer timer(ProfileStage::Update, "showEdgeClusters");
+        edgeClustersVisible = state == Qt::Checked;
+        scheduleUpdate(UpdateEdgeClusters);
     }
 
     void logCheckboxChange(int state) {
+        TraceScope trace("logCheckboxChange");
         bool logEnabled = state == Qt::Checked;
 
         widgets.histogram->logarithmicScaleEnabled = logEnabled;
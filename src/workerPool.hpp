@@ -0,0 +1,284 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+inline unsigned workerCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Prints an exception that escaped a task, tasks have nobody to throw to
+inline void reportTaskError(std::exception_ptr error) {
+    try {
+        std::rethrow_exception(error);
+    }
+    catch (const std::exception& e) {
+        std::cout << "Task failed: " << e.what() << std::endl;
+    }
+    catch (...) {
+        std::cout << "Task failed with an unknown exception" << std::endl;
+    }
+}
+
+// Fixed set of threads running queued tasks, the task with the highest priority runs first,
+// tasks of equal priority run in submission order.
+class WorkerPool {
+    struct Task {
+        uint64_t id;
+        int priority;
+        const void* owner;
+        std::function<void()> run;
+    };
+
+    std::mutex mutex;
+    std::condition_variable_any wakeUp;
+    std::vector<Task> queue;
+    uint64_t nextId = 0;
+    std::vector<std::jthread> workers;
+
+    void work(std::stop_token stop) {
+        while (true) {
+            Task task;
+            {
+                std::unique_lock lock(mutex);
+                if (!wakeUp.wait(lock, stop, [this]() { return !queue.empty(); })) {
+                    return;
+                }
+                auto next = std::min_element(queue.begin(), queue.end(), [](const Task& l, const Task& r) {
+                    return l.priority != r.priority ? l.priority > r.priority : l.id < r.id;
+                });
+                task = std::move(*next);
+                queue.erase(next);
+            }
+            try {
+                task.run();
+            }
+            catch (...) {
+                reportTaskError(std::current_exception());
+            }
+        }
+    }
+
+public:
+    explicit WorkerPool(unsigned threadCount = workerCount()) {
+        for (unsigned i = 0; i < threadCount; i++) {
+            workers.emplace_back([this](std::stop_token stop) { work(stop); });
+        }
+    }
+
+    // Queued tasks are dropped, running ones are finished
+    ~WorkerPool() {
+        for (auto& worker : workers) {
+            worker.request_stop();
+        }
+        workers.clear();
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    uint64_t submit(std::function<void()> task, int priority = 0, const void* owner = nullptr) {
+        std::lock_guard lock(mutex);
+        uint64_t id = nextId++;
+        queue.push_back({ id, priority, owner, std::move(task) });
+        wakeUp.notify_one();
+        return id;
+    }
+
+    // Returns false if the task already started
+    bool prioritize(uint64_t id, int priority) {
+        std::lock_guard lock(mutex);
+        auto task = std::find_if(queue.begin(), queue.end(), [id](const Task& t) { return t.id == id; });
+        if (task == queue.end()) {
+            return false;
+        }
+        task->priority = std::max(task->priority, priority);
+        return true;
+    }
+
+    // Removes all queued tasks of `owner` and returns their number
+    size_t cancel(const void* owner) {
+        std::lock_guard lock(mutex);
+        return std::erase_if(queue, [owner](const Task& t) { return t.owner == owner; });
+    }
+};
+
+inline WorkerPool& sharedWorkerPool() {
+    static WorkerPool pool;
+    return pool;
+}
+
+// Tasks submitted through a group are cancelled or waited for before the group is destroyed,
+// so they can safely refer to the object owning the group. Exceptions of tasks are reported when they
+// happen and the first one is rethrown by wait().
+class TaskGroup {
+    WorkerPool& pool;
+    // The counter is only changed and read under the mutex, so a waiter can't return and destroy the group
+    // while a finishing task still notifies it
+    std::mutex mutex;
+    std::condition_variable allFinished;
+    int unfinished = 0;
+    std::exception_ptr error;
+
+    void finished(int count, std::exception_ptr taskError = nullptr) {
+        std::lock_guard lock(mutex);
+        if (taskError && !error) {
+            error = taskError;
+        }
+        unfinished -= count;
+        if (unfinished == 0) {
+            allFinished.notify_all();
+        }
+    }
+
+    void waitAll() {
+        std::unique_lock lock(mutex);
+        allFinished.wait(lock, [this]() { return unfinished == 0; });
+    }
+
+public:
+    explicit TaskGroup(WorkerPool& pool = sharedWorkerPool()) :
+        pool(pool) { }
+
+    ~TaskGroup() {
+        cancelAndWait();
+    }
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    uint64_t submit(std::function<void()> task, int priority = 0) {
+        {
+            std::lock_guard lock(mutex);
+            unfinished++;
+        }
+        return pool.submit([this, task = std::move(task)]() {
+            std::exception_ptr taskError;
+            try {
+                task();
+            }
+            catch (...) {
+                taskError = std::current_exception();
+                reportTaskError(taskError);
+            }
+            finished(1, taskError);
+        }, priority, this);
+    }
+
+    bool prioritize(uint64_t id, int priority) {
+        return pool.prioritize(id, priority);
+    }
+
+    // Drops queued tasks, running ones keep running
+    void cancel() {
+        int cancelled = static_cast<int>(pool.cancel(this));
+        if (cancelled > 0) {
+            finished(cancelled);
+        }
+    }
+
+    // Waits until all submitted tasks finished, then rethrows the first exception of a task since the last wait
+    void wait() {
+        waitAll();
+        std::exception_ptr taskError;
+        {
+            std::lock_guard lock(mutex);
+            std::swap(taskError, error);
+        }
+        if (taskError) {
+            std::rethrow_exception(taskError);
+        }
+    }
+
+    // Doesn't throw, exceptions of tasks were already reported
+    void cancelAndWait() {
+        cancel();
+        waitAll();
+    }
+};
+
+namespace parallelDetail {
+
+    // Shared with the pool tasks of one parallelChunks call, tasks that start after all chunks were claimed only
+    // touch the counters, so they may outlive the call
+    struct Chunks {
+        unsigned chunkCount = 0;
+        std::function<void(unsigned)> run;
+        std::atomic<unsigned> next = 0;
+        std::atomic<unsigned> finished = 0;
+        std::atomic<bool> failed = false;
+        std::mutex mutex;
+        std::exception_ptr error;
+    };
+
+    // Runs unclaimed chunks until none are left, chunks claimed after a failure are skipped
+    inline void runChunks(Chunks& chunks) {
+        for (unsigned chunk = chunks.next++; chunk < chunks.chunkCount; chunk = chunks.next++) {
+            if (!chunks.failed) {
+                try {
+                    chunks.run(chunk);
+                }
+                catch (...) {
+                    std::lock_guard lock(chunks.mutex);
+                    if (!chunks.error) {
+                        chunks.error = std::current_exception();
+                    }
+                    chunks.failed = true;
+                }
+            }
+            if (++chunks.finished == chunks.chunkCount) {
+                chunks.finished.notify_all();
+            }
+        }
+    }
+}
+
+// Splits [0, count) into `chunkCount` contiguous chunks and calls `body(chunk, begin, end)` for each of them.
+// Chunks are deterministic, so results can be merged in order. They run on the shared worker pool ahead of other
+// tasks and on the calling thread, which keeps claiming chunks itself, so calls from pool tasks can't deadlock.
+// The first exception thrown by `body` is rethrown once all chunks finished.
+template<typename F>
+void parallelChunks(size_t count, unsigned chunkCount, F&& body) {
+    chunkCount = std::max(1u, std::min<unsigned>(chunkCount, static_cast<unsigned>(std::max<size_t>(count, 1))));
+    if (chunkCount == 1) {
+        body(0u, size_t{ 0 }, count);
+        return;
+    }
+
+    auto chunks = std::make_shared<parallelDetail::Chunks>();
+    chunks->chunkCount = chunkCount;
+    chunks->run = [&body, count, chunkCount](unsigned chunk) {
+        body(chunk, count * chunk / chunkCount, count * (chunk + 1) / chunkCount);
+    };
+    for (unsigned helper = 1; helper < chunkCount; helper++) {
+        sharedWorkerPool().submit([chunks]() { parallelDetail::runChunks(*chunks); }, std::numeric_limits<int>::max());
+    }
+    parallelDetail::runChunks(*chunks);
+
+    for (unsigned finished = chunks->finished; finished != chunkCount; finished = chunks->finished) {
+        chunks->finished.wait(finished);
+    }
+    if (chunks->error) {
+        std::rethrow_exception(chunks->error);
+    }
+}
+
+// Calls `body(i)` for every i in [0, count) using all hardware threads.
+template<typename F>
+void parallelFor(size_t count, F&& body) {
+    parallelChunks(count, workerCount(), [&body](unsigned, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            body(i);
+        }
+    });
+}